@@ -0,0 +1,281 @@
+#ifndef CONSOLE_MUX_H
+#define CONSOLE_MUX_H
+
+#include <Arduino.h>
+
+// Multiplexes several logical byte streams over one physical Stream.
+//
+// Every frame on the wire is SOF, then channel id, payload length (0-255),
+// payload and a CRC-8 over those three, all byte-stuffed: 0x7E and 0x7D
+// go out as 0x7D followed by the byte XOR 0x20, so 0x7E only ever starts a
+// frame, and the receiver resyncs on the next one after a lost or
+// corrupted byte. Frames that fail the CRC are dropped and counted.
+// Frames to the device carry at most MUX_RX_BUF_SIZE - 1 payload bytes.
+// Conventional channel ids: 0 = console, 1 = telemetry, 2 = log.
+// See tools/mux_demux.py for the host side.
+
+// =============================================================
+// SECTION 1: CONFIGURATION & TYPES
+// =============================================================
+
+static const uint8_t MUX_SOF = 0x7E;
+static const uint8_t MUX_ESC = 0x7D;
+static const size_t MUX_RX_BUF_SIZE = 32;
+static const size_t MUX_TX_BUF_SIZE = 32;
+
+namespace console_detail {
+
+// CRC-8, polynomial 0x07, initial value 0, no reflection
+inline uint8_t muxCrc8(uint8_t crc, uint8_t c) {
+  crc ^= c;
+  for (uint8_t i = 0; i < 8; i++)
+    crc = crc & 0x80 ? (uint8_t)(crc << 1) ^ 0x07 : (uint8_t)(crc << 1);
+  return crc;
+}
+
+// What a channel needs from its multiplexer
+class MuxLink {
+public:
+  virtual void pump() = 0;
+  virtual void sendFrame(uint8_t ch, const uint8_t *data, size_t len) = 0;
+};
+
+} // namespace console_detail
+
+// =============================================================
+// SECTION 2: VIRTUAL CHANNEL STREAM
+// =============================================================
+
+class MuxChannel : public Stream {
+public:
+  MuxChannel()
+      : _link(nullptr), _id(0), _rxHead(0), _rxTail(0), _txLen(0),
+        _lineFlush(false) {}
+
+  void attach(console_detail::MuxLink *link, uint8_t id) {
+    _link = link;
+    _id = id;
+  }
+
+  // Emit a frame at every '\n' instead of waiting for a full buffer.
+  // Useful for text channels such as the console.
+  void setLineFlush(bool on) { _lineFlush = on; }
+
+  // Bytes that fit in the receive buffer
+  size_t room() const {
+    return (_rxTail + MUX_RX_BUF_SIZE - _rxHead - 1) % MUX_RX_BUF_SIZE;
+  }
+
+  // --- Stream ---
+  int available() override {
+    _link->pump();
+    return (int)((_rxHead + MUX_RX_BUF_SIZE - _rxTail) % MUX_RX_BUF_SIZE);
+  }
+
+  int read() override {
+    if (available() == 0)
+      return -1;
+    uint8_t c = _rx[_rxTail];
+    _rxTail = (_rxTail + 1) % MUX_RX_BUF_SIZE;
+    return c;
+  }
+
+  int peek() override {
+    if (available() == 0)
+      return -1;
+    return _rx[_rxTail];
+  }
+
+  // --- Print ---
+  size_t write(uint8_t c) override {
+    _tx[_txLen++] = c;
+    if (_txLen == MUX_TX_BUF_SIZE || (_lineFlush && c == '\n'))
+      flush();
+    return 1;
+  }
+
+  size_t write(const uint8_t *buf, size_t len) override {
+    for (size_t i = 0; i < len; i++)
+      write(buf[i]);
+    return len;
+  }
+
+  int availableForWrite() override { return (int)(MUX_TX_BUF_SIZE - _txLen); }
+
+  void flush() override {
+    if (_txLen == 0)
+      return;
+    _link->sendFrame(_id, _tx, _txLen);
+    _txLen = 0;
+  }
+
+  // The multiplexer writes a frame's payload behind the buffered bytes as
+  // it arrives (only once it fits), and makes it readable once the CRC
+  // checks out
+  void stage(size_t i, uint8_t c) {
+    _rx[(_rxHead + i) % MUX_RX_BUF_SIZE] = c;
+  }
+
+  void commit(size_t n) { _rxHead = (_rxHead + n) % MUX_RX_BUF_SIZE; }
+
+  using Print::write;
+
+private:
+  console_detail::MuxLink *_link;
+  uint8_t _id;
+  uint8_t _rx[MUX_RX_BUF_SIZE];
+  size_t _rxHead, _rxTail;
+  uint8_t _tx[MUX_TX_BUF_SIZE];
+  size_t _txLen;
+  bool _lineFlush;
+};
+
+// =============================================================
+// SECTION 3: MULTIPLEXER
+// =============================================================
+
+template <uint8_t N_CHANNELS>
+class ConsoleMux : public console_detail::MuxLink {
+public:
+  ConsoleMux(Stream &io)
+      : _io(io), _state(WAIT_SOF), _escaped(false), _rxCh(0), _rxLen(0),
+        _rxPos(0), _rxCrc(0), _badFrames(0) {
+    for (uint8_t i = 0; i < N_CHANNELS; i++)
+      _channels[i].attach(this, i);
+  }
+
+  // Channels keep a pointer back to the multiplexer
+  ConsoleMux(const ConsoleMux &) = delete;
+  ConsoleMux &operator=(const ConsoleMux &) = delete;
+
+  MuxChannel &channel(uint8_t id) { return _channels[id]; }
+
+  // Frames dropped for a bad CRC, a length over MUX_RX_BUF_SIZE - 1, or a
+  // SOF before their end (a lost byte, say)
+  uint16_t badFrames() const { return _badFrames; }
+
+  // Send a block straight to the wire, bypassing the channel buffer.
+  // Meant for binary telemetry records.
+  void send(uint8_t ch, const void *data, size_t len) {
+    _channels[ch].flush(); // Keep ordering within the channel
+    sendFrame(ch, static_cast<const uint8_t *>(data), len);
+  }
+
+  // Call from loop(): routes incoming frames and flushes pending output
+  void poll() {
+    pump();
+    for (uint8_t i = 0; i < N_CHANNELS; i++)
+      _channels[i].flush();
+  }
+
+  // A frame for a channel without room for its payload stays in the input
+  // until that channel is read, and so does everything behind it
+  void pump() override {
+    while (_io.available()) {
+      if (_state == PAYLOAD && _rxCh < N_CHANNELS &&
+          _channels[_rxCh].room() < _rxLen)
+        return;
+      decode((uint8_t)_io.read());
+    }
+  }
+
+  void sendFrame(uint8_t ch, const uint8_t *data, size_t len) override {
+    while (len > 0) {
+      uint8_t chunk = len > 255 ? 255 : (uint8_t)len;
+      uint8_t crc = console_detail::muxCrc8(0, ch);
+      crc = console_detail::muxCrc8(crc, chunk);
+      for (uint8_t i = 0; i < chunk; i++)
+        crc = console_detail::muxCrc8(crc, data[i]);
+      _io.write(MUX_SOF);
+      writeStuffed(&ch, 1);
+      writeStuffed(&chunk, 1);
+      writeStuffed(data, chunk);
+      writeStuffed(&crc, 1);
+      data += chunk;
+      len -= chunk;
+    }
+  }
+
+private:
+  enum State : uint8_t { WAIT_SOF, CHANNEL, LENGTH, PAYLOAD, CHECK };
+
+  Stream &_io;
+  MuxChannel _channels[N_CHANNELS];
+  State _state;
+  bool _escaped;
+  uint8_t _rxCh;
+  uint8_t _rxLen;
+  uint8_t _rxPos;
+  uint8_t _rxCrc;
+  uint16_t _badFrames;
+
+  // Runs without a byte to escape go out in one write() call
+  void writeStuffed(const uint8_t *data, size_t len) {
+    size_t run = 0;
+    for (size_t i = 0; i < len; i++) {
+      if (data[i] != MUX_SOF && data[i] != MUX_ESC)
+        continue;
+      if (i > run)
+        _io.write(data + run, i - run);
+      _io.write(MUX_ESC);
+      _io.write(data[i] ^ 0x20);
+      run = i + 1;
+    }
+    if (len > run)
+      _io.write(data + run, len - run);
+  }
+
+  void decode(uint8_t c) {
+    if (c == MUX_SOF) {
+      if (_state != WAIT_SOF)
+        _badFrames++;
+      _state = CHANNEL;
+      _escaped = false;
+      _rxCrc = 0;
+      return;
+    }
+    if (_state == WAIT_SOF)
+      return;
+    if (c == MUX_ESC) {
+      _escaped = true;
+      return;
+    }
+    if (_escaped) {
+      c ^= 0x20;
+      _escaped = false;
+    }
+    if (_state != CHECK)
+      _rxCrc = console_detail::muxCrc8(_rxCrc, c);
+
+    switch (_state) {
+    case CHANNEL:
+      _rxCh = c;
+      _state = LENGTH;
+      break;
+    case LENGTH:
+      _rxLen = c;
+      _rxPos = 0;
+      _state = c ? PAYLOAD : CHECK;
+      if (c > MUX_RX_BUF_SIZE - 1) {
+        _badFrames++;
+        _state = WAIT_SOF;
+      }
+      break;
+    case PAYLOAD:
+      // Frames for unknown channels are checked, then skipped
+      if (_rxCh < N_CHANNELS)
+        _channels[_rxCh].stage(_rxPos, c);
+      if (++_rxPos == _rxLen)
+        _state = CHECK;
+      break;
+    default:
+      if (c != _rxCrc)
+        _badFrames++;
+      else if (_rxCh < N_CHANNELS)
+        _channels[_rxCh].commit(_rxLen);
+      _state = WAIT_SOF;
+    }
+  }
+};
+
+#endif
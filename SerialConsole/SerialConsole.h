@@ -10,354 +10,3420 @@ extern "C" void print_embedded_source_code() __attribute__((weak));
 // SECTION 1: CONFIGURATION & TYPES
 // =============================================================
 
-static const size_t INPUT_BUF_SIZE = 64;
+// Software flow control bytes (DC1 / DC3)
+static const uint8_t XON = 0x11;
+static const uint8_t XOFF = 0x13;
+
+// Optional per-line checksum, sent as a trailing "*XX" or "*XXXX"
+enum LineIntegrity : uint8_t {
+  INTEGRITY_NONE,
+  INTEGRITY_NMEA,  // XOR of all characters before '*', 2 hex digits
+  INTEGRITY_CRC16, // CRC-16/CCITT-FALSE of the same, 4 hex digits
+};
+
+// How much the console says when a line can't be executed
+enum ErrorVerbosity : uint8_t {
+  ERRORS_NONE,    // Nothing
+  ERRORS_TERSE,   // One line: "Unknown command.", "Invalid argument 'x'."
+  ERRORS_VERBOSE, // Plus the usage string of the command
+};
 
 typedef void (*VoidFuncPtr)();
 
-// Invoker takes name/usage to print specific errors
-typedef void (*InvokerFunc)(VoidFuncPtr f, const char *name, const char *usage,
-                            Stream &s);
+// Parses argument 'index' into the command's typed argument pack
+typedef bool (*ArgParserFunc)(void *args, uint8_t index, char *token);
+
+// Calls the command with an argument pack filled by its parser
+typedef void (*InvokerFunc)(VoidFuncPtr f, const void *args);
+
+// What all commands with the same parameter types share. Each console
+// keeps one table of these in flash, commands refer to it by index.
+struct CommandSignature {
+  ArgParserFunc parser;
+  InvokerFunc invoker;
+  uint8_t argc;
+};
 
+// The signature index is kept apart (see ErasedTable), so records have
+// no padding
 struct Command {
   const char *name;
   const char *usage;
   VoidFuncPtr func;
-  InvokerFunc invoker;
+};
+
+// Counters kept when Config::STATS is on
+struct ConsoleStats {
+  uint32_t lines;
+  uint16_t errors;
+  uint16_t naks;
+  unsigned long maxDispatchUs;
+  uint16_t rxPeak;   // Most input bytes found waiting at once
+  uint16_t overruns; // Times the RX buffer or held input was found full
+};
+
+// =============================================================
+// SECTION 2: POLICIES (COMPILE-TIME FEATURE SELECTION)
+// =============================================================
+
+// --- Tokenizers: which input characters separate tokens ---
+struct SpaceTokenizer {
+  static bool isDelimiter(char c) { return c == ' '; }
+};
+
+struct WhitespaceTokenizer {
+  static bool isDelimiter(char c) { return c == ' ' || c == '\t'; }
+};
+
+// --- Lookup: how a command name is resolved to a table slot ---
+// Works on any command table (see "Command Tables" below) through name(i)
+struct LinearLookup {
+  template <size_t N> struct Index {
+    template <typename Table> void build(const Table &) {}
+
+    template <typename Table>
+    int find(const Table &table, const char *token) const {
+      for (size_t i = 0; i < N; i++) {
+        if (strcmp(token, table.name(i)) == 0)
+          return (int)i;
+      }
+      return -1;
+    }
+  };
+};
+
+// Compares a one byte hash before falling back to strcmp.
+// Costs N bytes of RAM, pays off with many or similar names.
+struct HashedLookup {
+  static uint8_t hash(const char *s) {
+    uint8_t h = 0;
+    while (*s)
+      h = h * 31 + (uint8_t)*s++;
+    return h;
+  }
+
+  template <size_t N> struct Index {
+    uint8_t hashes[N ? N : 1];
+
+    template <typename Table> void build(const Table &table) {
+      for (size_t i = 0; i < N; i++)
+        hashes[i] = hash(table.name(i));
+    }
+
+    template <typename Table>
+    int find(const Table &table, const char *token) const {
+      uint8_t h = hash(token);
+      for (size_t i = 0; i < N; i++) {
+        if (hashes[i] == h && strcmp(token, table.name(i)) == 0)
+          return (int)i;
+      }
+      return -1;
+    }
+  };
+};
+
+// Echo, help and verbose errors; every other feature is off, so the
+// default build stays close to the plain console. To change that, derive
+// and override, e.g.
+//   struct MyConfig : DefaultConsoleConfig {
+//     static const bool FLOW_CONTROL = true;
+//     static const ErrorVerbosity ERROR_TEXT = ERRORS_TERSE;
+//   };
+//   auto console = createConsole<MyConfig>(...);
+// Disabled features generate no code.
+struct DefaultConsoleConfig {
+  static const size_t INPUT_BUF_SIZE = 64;
+  static const size_t OUTPUT_BUF_SIZE = 64;
+  // Room for the parsed arguments of one command
+  static const size_t ARG_STORE_SIZE = 32;
+  // Lines that can be read ahead of the one running; each slot costs
+  // INPUT_BUF_SIZE + ARG_STORE_SIZE and a few bytes
+  static const uint8_t LINE_SLOTS = 1;
+
+  typedef SpaceTokenizer Tokenizer;
+  typedef LinearLookup Lookup;
+
+  static const bool ECHO_LINES = true;   // "> line" before running it
+  static const bool HELP_COMMAND = true; // Built-in "help"
+  static const ErrorVerbosity ERROR_TEXT = ERRORS_VERBOSE;
+  static const bool FLOW_CONTROL = false;   // Output queue, XON/XOFF, CTS
+  static const bool LINE_INTEGRITY = false; // setLineIntegrity()
+  static const bool IDLE_TIMEOUT = false;   // setIdleTimeout()
+  static const bool STATS = false;          // stats() and a "stats" command
+  static const bool BENCH = false;          // "bench <n> <command line>"
+  static const bool PING = false;           // "ping <seq> <host_ts>"
+  static const bool LINK_TEST = false;      // "flood" and "absorb"
+  static const bool BAUD_SWITCH = false;    // "baud <rate>", setBaudHook()
+  static const bool OUT_OF_BAND = false;    // setBreak(), checkBreak()
+  static const bool PROMPTS = false;        // prompt() from a command
+  static const bool JSON_LINES = false;     // "json on|off", setJsonLines()
+  // Build errors for blank, untypable or built-in names, and for duplicates
+  // in tables of up to DUPLICATE_CHECK_MAX commands: comparing every pair
+  // costs compile time quadratic in the count (+2.6 s at 64 commands).
+  static const bool NAME_CHECKS = true;
+  static const size_t DUPLICATE_CHECK_MAX = 32;
 };
 
 // =============================================================
-// SECTION 2: TEMPLATE ENGINE (PARSING & VALIDATION)
+// SECTION 3: OUTPUT PATH (BUFFERING & FLOW CONTROL)
 // =============================================================
 namespace console_detail {
 
-// --- 0. Type Traits (Manual implementation for Arduino compatibility) ---
-template <typename T> struct remove_reference {
-  typedef T type;
-};
-template <typename T> struct remove_reference<T &> {
-  typedef T type;
-};
-template <typename T> struct remove_reference<T &&> {
-  typedef T type;
-};
+template <bool COND, typename A, typename B> struct conditional {
+  typedef A type;
+};
+template <typename A, typename B> struct conditional<false, A, B> {
+  typedef B type;
+};
+
+// Cursor of a flash region being streamed out cooperatively
+struct ProgmemJob {
+  const char *pos;
+  const char *end;
+
+  ProgmemJob() : pos(nullptr), end(nullptr) {}
+
+  void start(const char *begin, const char *stop) {
+    pos = begin;
+    end = stop;
+  }
+
+  bool active() const { return pos != nullptr; }
+  void stop() { pos = nullptr; }
+
+  // Next byte, or 0 once the region (or its terminator) is exhausted
+  char next() {
+    char c = pgm_read_byte(pos++);
+    if (c == 0 || pos >= end)
+      pos = nullptr;
+    return c;
+  }
+};
+
+// Console output is queued here and drained from handleInput() as far as
+// the stream has TX room and the receiver allows (XON/XOFF and/or a CTS
+// pin). Like HardwareSerial, a write into a full queue waits: for the
+// UART, and for a receiver that holds the link off, however long that
+// takes. No output is lost. While it waits for XON, input ahead of it is
+// moved into 'held' (the console's HeldInput) so the XON can be seen.
+template <size_t SIZE, typename Held> class OutputQueue : public Print {
+public:
+  OutputQueue(Stream &s, Held &held)
+      : _stream(s), _held(held), _head(0), _tail(0), _xonXoff(false),
+        _paused(false), _uncapped(false), _roomKnown(false), _raw(false),
+        _ctsPin(-1) {}
+
+  Print &printer() { return *this; }
+  ProgmemJob *job() { return &_job; }
+
+  void setXonXoff(bool on) {
+    _xonXoff = on;
+    _paused = false;
+  }
+
+  // CTS input, active low. Pass -1 to disable.
+  void setCtsPin(int pin) {
+    _ctsPin = pin;
+    if (pin >= 0)
+      pinMode(pin, INPUT_PULLUP);
+  }
+
+  // Drain with plain writes, however long they take, whatever the
+  // stream's availableForWrite() says
+  void setUncapped(bool on) { _uncapped = on; }
+
+  // While input is raw data ("absorb"), XON and XOFF are left in it
+  void setRawInput(bool on) { _raw = on; }
+
+  // Returns true if the input byte was a flow control byte and got consumed
+  bool filterInput(char c) {
+    if (!_xonXoff || _raw)
+      return false;
+    if (c == XOFF) {
+      _paused = true;
+      return true;
+    }
+    if (c == XON) {
+      _paused = false;
+      return true;
+    }
+    return false;
+  }
+
+  bool streaming() const { return _job.active(); }
+
+  // Drops queued output and the running job
+  void cancel() {
+    _job.stop();
+    _tail = _head;
+  }
+
+  // Refill from the active job and drain as much as the link allows
+  void pump() {
+    while (_job.active() && !full()) {
+      char c = _job.next();
+      if (c != 0)
+        push(c);
+    }
+    drain();
+  }
+
+  // Everything queued into the stream, e.g. before a command that may
+  // write to it directly. Gives up while the receiver holds the link off.
+  void drainAll() {
+    while (_head != _tail && clearToSend())
+      drain(true);
+  }
+
+  // --- Print ---
+  size_t write(uint8_t c) override {
+    makeRoom();
+    push(c);
+    return 1;
+  }
+
+  // One virtual call per chunk instead of per byte
+  size_t write(const uint8_t *buf, size_t len) override {
+    for (size_t i = 0; i < len; i++) {
+      makeRoom();
+      push(buf[i]);
+    }
+    return len;
+  }
+
+  int availableForWrite() override {
+    return (int)((_tail + SIZE - _head - 1) % SIZE);
+  }
+
+  void flush() override {
+    drainAll();
+    _stream.flush();
+  }
+
+  using Print::write;
+
+private:
+  Stream &_stream;
+  Held &_held;
+  uint8_t _buf[SIZE];
+  size_t _head, _tail;
+  bool _xonXoff;
+  bool _paused;
+  bool _uncapped;
+  bool _roomKnown; // availableForWrite() reported room at least once
+  bool _raw;
+  int8_t _ctsPin; // Pin numbers fit, and it packs with the flags above
+  ProgmemJob _job;
+
+  bool full() const { return (_head + 1) % SIZE == _tail; }
+
+  // Waits while the queue is full, for the stream or the receiver. Input
+  // in front of an XON is held for the console, or lost once that's full.
+  void makeRoom() {
+    while (full()) {
+      if (clearToSend())
+        drain(true);
+      else if (_xonXoff && !_raw && _stream.available())
+        _held.push((char)_stream.read());
+    }
+  }
+
+  // -1 for no limit. Print::availableForWrite() returns 0 unless a stream
+  // overrides it, so 0 only means "full" once the stream reported room.
+  int txRoom() {
+    if (_uncapped)
+      return -1;
+    int room = _stream.availableForWrite();
+    if (room > 0)
+      _roomKnown = true;
+    return _roomKnown ? room : -1;
+  }
+
+  void push(uint8_t c) {
+    _buf[_head] = c;
+    _head = (_head + 1) % SIZE;
+  }
+
+  bool clearToSend() {
+    // Catch XOFF that arrives mid-drain without consuming other input
+    if (_xonXoff && !_raw) {
+      int c = _stream.peek();
+      if (c == XON || c == XOFF)
+        filterInput((char)_stream.read());
+    }
+    if (_paused)
+      return false;
+    return _ctsPin < 0 || digitalRead(_ctsPin) == LOW;
+  }
+
+  // As much as the stream has room for; 'wait' writes at least one byte,
+  // blocking in the stream's write() like HardwareSerial. The room is
+  // asked again once used up, as writing may have freed more (a stream
+  // that sends full blocks on, say).
+  void drain(bool wait = false) {
+    int room = 0;
+    while (_head != _tail && clearToSend()) {
+      if (room == 0) {
+        room = txRoom();
+        if (room == 0 && !wait)
+          return;
+        if (room == 0)
+          room = 1;
+        wait = false;
+      }
+      if (room > 0)
+        room--;
+      _stream.write(_buf[_tail]);
+      _tail = (_tail + 1) % SIZE;
+    }
+  }
+};
+
+// Used instead of OutputQueue when Config::FLOW_CONTROL is off
+class DirectOutput {
+public:
+  template <typename Held> DirectOutput(Stream &s, Held &) : _stream(s) {}
+
+  Print &printer() { return _stream; }
+  ProgmemJob *job() { return nullptr; }
+  bool filterInput(char) { return false; }
+  bool streaming() const { return false; }
+  void cancel() {}
+  void pump() {}
+  void drainAll() {}
+  void setUncapped(bool) {}
+  void setRawInput(bool) {}
+
+private:
+  Stream &_stream;
+};
+
+// Output of the console currently running handleInput(), for code that has
+// no console reference (e.g. EMBED_SOURCE_CODE)
+inline Print *&activeOutput() {
+  static Print *out = nullptr;
+  return out;
+}
+
+inline ProgmemJob *&activeJob() {
+  static ProgmemJob *job = nullptr;
+  return job;
+}
+
+inline void streamProgmem(const char *begin, const char *end) {
+  if (activeJob()) {
+    activeJob()->start(begin, end);
+    return;
+  }
+  Print &out = activeOutput() ? *activeOutput() : Serial;
+  for (const char *p = begin; p < end; p++) {
+    char c = pgm_read_byte(p);
+    if (c == 0)
+      break;
+    out.print(c);
+  }
+}
+
+// --- Number Formatting ---
+// Print::print() divides once per digit (a libgcc call for 32-bit values
+// on AVR) and float output goes out a character at a time. These format
+// two digits per division into a stack buffer and write it in one call.
+
+template <typename T = void> struct DigitPairs {
+  static const char table[201];
+};
+
+template <typename T>
+const char DigitPairs<T>::table[201] PROGMEM =
+    "000102030405060708091011121314151617181920212223242526272829"
+    "303132333435363738394041424344454647484950515253545556575859"
+    "606162636465666768697071727374757677787980818283848586878889"
+    "90919293949596979899";
+
+inline char *putPair(char *end, uint8_t n) {
+  const char *p = DigitPairs<>::table + 2 * n;
+  *--end = pgm_read_byte(p + 1);
+  *--end = pgm_read_byte(p);
+  return end;
+}
+
+// Writes v right-aligned in front of 'end', returns its first digit
+inline char *formatDec(char *end, unsigned long v) {
+  // Wide division only while the value needs it, 16-bit is much cheaper
+  // on 8-bit targets
+  while (v >= 65536UL) {
+    unsigned long q = v / 100;
+    end = putPair(end, (uint8_t)(v - q * 100));
+    v = q;
+  }
+  uint16_t w = (uint16_t)v;
+  while (w >= 100) {
+    uint16_t q = w / 100;
+    end = putPair(end, (uint8_t)(w - q * 100));
+    w = q;
+  }
+  if (w >= 10)
+    return putPair(end, (uint8_t)w);
+  *--end = (char)('0' + w);
+  return end;
+}
+
+// Room for any number below, sign included
+static const size_t NUMBER_BUF_SIZE = 24;
+
+// Hex digits of v in front of 'end'; 'a' picks the letter case
+inline char *formatHex(char *end, unsigned long v, char a = 'A') {
+  do {
+    uint8_t d = v & 15;
+    *--end = (char)(d < 10 ? '0' + d : a - 10 + d);
+    v >>= 4;
+  } while (v);
+  return end;
+}
+
+// v with a decimal point 'decimals' (up to 9) digits from the right:
+// 1234, 2 gives "12.34". Uses one byte in front of the digits.
+inline char *formatPoint(char *end, unsigned long v, uint8_t decimals) {
+  if (decimals > 9)
+    decimals = 9;
+  char *s = formatDec(end, v);
+  while (end - s <= decimals)
+    *--s = '0';
+  if (decimals) {
+    // Move the integer digits one left to open a gap for the point
+    size_t whole = end - s - decimals;
+    memmove(s - 1, s, whole);
+    s--;
+    s[whole] = '.';
+  }
+  return s;
+}
+
+// What Print::print(float) shows instead of digits, or nullptr
+inline const char *floatSpecial(float v) {
+  if (isnan(v))
+    return "nan";
+  if (isinf(v))
+    return "inf";
+  if (v > 4294967040.0f || v < -4294967040.0f)
+    return "ovf";
+  return nullptr;
+}
+
+// |v| to 'decimals' (up to 9) places with the arithmetic of the core's
+// Print::printFloat(), so the digits are the same: add half a unit of
+// the last place, then peel off one fraction digit per multiply by 10.
+// Only the output is batched. floatSpecial() values excluded.
+inline char *formatFloat(char *end, float v, uint8_t decimals) {
+  if (decimals > 9)
+    decimals = 9;
+  double number = v < 0 ? -(double)v : v;
+  double rounding = 0.5;
+  for (uint8_t i = 0; i < decimals; i++)
+    rounding /= 10.0;
+  number += rounding;
+  unsigned long whole = (unsigned long)number;
+  double remainder = number - (double)whole;
+
+  char *s = end - decimals;
+  for (char *d = s; d < end; d++) {
+    remainder *= 10.0;
+    unsigned int digit = (unsigned int)remainder;
+    *d = (char)('0' + digit);
+    remainder -= digit;
+  }
+  if (decimals)
+    *--s = '.';
+  return formatDec(s, whole);
+}
+
+inline size_t writeNumber(Print &p, char *s, char *end, bool negative) {
+  if (negative)
+    *--s = '-';
+  return p.write(s, end - s);
+}
+
+inline size_t printDec(Print &p, unsigned long v, bool negative = false) {
+  char buf[NUMBER_BUF_SIZE];
+  char *end = buf + sizeof(buf);
+  return writeNumber(p, formatDec(end, v), end, negative);
+}
+
+inline size_t printDec(Print &p, long v) {
+  if (v < 0)
+    return printDec(p, 0UL - (unsigned long)v, true);
+  return printDec(p, (unsigned long)v);
+}
+
+inline size_t printDec(Print &p, unsigned int v) {
+  return printDec(p, (unsigned long)v);
+}
+
+inline size_t printDec(Print &p, int v) { return printDec(p, (long)v); }
+
+// Upper case, zero padded to 'width' digits
+inline size_t printHex(Print &p, unsigned long v, uint8_t width) {
+  char buf[NUMBER_BUF_SIZE];
+  char *end = buf + sizeof(buf);
+  char *s = formatHex(end, v);
+  while (s > buf && end - s < width)
+    *--s = '0';
+  return p.write(s, end - s);
+}
+
+// A scaled integer: printFixed(p, 1234, 2) prints "12.34"
+inline size_t printFixed(Print &p, long scaled, uint8_t decimals) {
+  char buf[NUMBER_BUF_SIZE];
+  char *end = buf + sizeof(buf);
+  unsigned long m = scaled < 0 ? 0UL - (unsigned long)scaled : scaled;
+  return writeNumber(p, formatPoint(end, m, decimals), end, scaled < 0);
+}
+
+// Same output as Print::print(float, decimals) for up to 9 decimals,
+// including "nan", "inf" and "ovf"
+inline size_t printFloat(Print &p, float v, uint8_t decimals) {
+  if (const char *text = floatSpecial(v))
+    return p.write(text);
+  char buf[NUMBER_BUF_SIZE];
+  char *end = buf + sizeof(buf);
+  return writeNumber(p, formatFloat(end, v, decimals), end, v < 0);
+}
+
+// --- Format Strings ---
+// console.printf(CONSOLE_FMT("..."), args...). The format is checked
+// against the argument types at compile time and kept in flash. At run
+// time it is walked once; output collects in a FormatSink and reaches
+// the console in a few large writes instead of one call per piece.
+//
+// Placeholders: %d %i %u %x %X %f %c %s and %%, with an optional 0 flag
+// and width (numbers) and .precision (%f, default 6).
+
+// Buffers formatted output on the stack
+class FormatSink {
+public:
+  explicit FormatSink(Print &out) : _out(out), _len(0), _total(0) {}
+
+  void put(char c) {
+    if (_len == sizeof(_buf))
+      flush();
+    _buf[_len++] = c;
+  }
+
+  void put(const char *s, size_t n) {
+    while (n--)
+      put(*s++);
+  }
+
+  // Returns the bytes written so far
+  size_t flush() {
+    _total += _out.write(_buf, _len);
+    _len = 0;
+    return _total;
+  }
+
+private:
+  Print &_out;
+  char _buf[32];
+  uint8_t _len;
+  size_t _total;
+};
+
+struct FormatSpec {
+  uint8_t width;
+  uint8_t precision;
+  bool zero;
+  char conv;
+};
+
+// Copies literal text up to the next placeholder into the sink and parses
+// the placeholder. Returns the position after it, or of the final NUL.
+inline const char *nextPlaceholder(FormatSink &sink, const char *p,
+                                   FormatSpec &spec) {
+  for (;;) {
+    char c = pgm_read_byte(p);
+    if (c == '\0')
+      return p;
+    p++;
+    if (c != '%') {
+      sink.put(c);
+      continue;
+    }
+    c = pgm_read_byte(p++);
+    if (c == '%') {
+      sink.put(c);
+      continue;
+    }
+    spec.zero = c == '0';
+    spec.width = 0;
+    for (; c >= '0' && c <= '9'; c = pgm_read_byte(p++))
+      spec.width = spec.width * 10 + (c - '0');
+    spec.precision = 6;
+    if (c == '.') {
+      spec.precision = 0;
+      for (c = pgm_read_byte(p++); c >= '0' && c <= '9';
+           c = pgm_read_byte(p++))
+        spec.precision = spec.precision * 10 + (c - '0');
+    }
+    spec.conv = c;
+    return p;
+  }
+}
+
+// Digits in s..end, padded to the placeholder's width
+inline void putNumber(FormatSink &sink, const FormatSpec &spec,
+                      const char *s, const char *end, bool negative) {
+  size_t len = (end - s) + negative;
+  if (negative && spec.zero)
+    sink.put('-');
+  for (; len < spec.width; len++)
+    sink.put(spec.zero ? '0' : ' ');
+  if (negative && !spec.zero)
+    sink.put('-');
+  sink.put(s, end - s);
+}
+
+// Which placeholders each kind of argument accepts, and how it's printed.
+// Arguments are converted to the kind's Value first.
+struct UnsignedArg {
+  typedef UnsignedArg Kind;
+  typedef unsigned long Value;
+  static constexpr bool accepts(char c) {
+    return c == 'd' || c == 'i' || c == 'u' || c == 'x' || c == 'X';
+  }
+  static void format(FormatSink &sink, const FormatSpec &spec,
+                     unsigned long v) {
+    char buf[NUMBER_BUF_SIZE];
+    char *end = buf + sizeof(buf);
+    char *s = spec.conv == 'x'   ? formatHex(end, v, 'a')
+              : spec.conv == 'X' ? formatHex(end, v)
+                                 : formatDec(end, v);
+    putNumber(sink, spec, s, end, false);
+  }
+};
+
+inline void formatSigned(FormatSink &sink, const FormatSpec &spec, long v) {
+  char buf[NUMBER_BUF_SIZE];
+  char *end = buf + sizeof(buf);
+  unsigned long m = v < 0 ? 0UL - (unsigned long)v : v;
+  putNumber(sink, spec, formatDec(end, m), end, v < 0);
+}
+
+// %u %x %X print the bits as unsigned U, as printf does: an int of -1 is
+// FFFF on AVR and FFFFFFFF where int is 32-bit
+template <typename U> struct SignedArg {
+  typedef SignedArg Kind;
+  typedef long Value;
+  static constexpr bool accepts(char c) { return UnsignedArg::accepts(c); }
+  static void format(FormatSink &sink, const FormatSpec &spec, long v) {
+    if (spec.conv == 'd' || spec.conv == 'i')
+      formatSigned(sink, spec, v);
+    else
+      UnsignedArg::format(sink, spec, (U)v);
+  }
+};
+
+struct FloatArg {
+  typedef FloatArg Kind;
+  typedef float Value;
+  static constexpr bool accepts(char c) { return c == 'f'; }
+  static void format(FormatSink &sink, const FormatSpec &spec, float v) {
+    if (const char *text = floatSpecial(v)) {
+      sink.put(text, strlen(text));
+      return;
+    }
+    char buf[NUMBER_BUF_SIZE];
+    char *end = buf + sizeof(buf);
+    putNumber(sink, spec, formatFloat(end, v, spec.precision), end, v < 0);
+  }
+};
+
+struct CharArg {
+  typedef CharArg Kind;
+  typedef char Value;
+  static constexpr bool accepts(char c) { return c == 'c'; }
+  static void format(FormatSink &sink, const FormatSpec &, char c) {
+    sink.put(c);
+  }
+};
+
+struct StringArg {
+  typedef StringArg Kind;
+  typedef const char *Value;
+  static constexpr bool accepts(char c) { return c == 's'; }
+  static void format(FormatSink &sink, const FormatSpec &, const char *s) {
+    if (s)
+      sink.put(s, strlen(s));
+  }
+};
+
+struct FlashStringArg {
+  typedef FlashStringArg Kind;
+  typedef const __FlashStringHelper *Value;
+  static constexpr bool accepts(char c) { return c == 's'; }
+  static void format(FormatSink &sink, const FormatSpec &,
+                     const __FlashStringHelper *s) {
+    const char *p = reinterpret_cast<const char *>(s);
+    for (char c; p && (c = pgm_read_byte(p)) != '\0'; p++)
+      sink.put(c);
+  }
+};
+
+// Types without a FormatArg can't be printed
+template <typename T> struct FormatArg;
+template <> struct FormatArg<signed char> : SignedArg<unsigned char> {};
+template <> struct FormatArg<short> : SignedArg<unsigned short> {};
+template <> struct FormatArg<int> : SignedArg<unsigned int> {};
+template <> struct FormatArg<long> : SignedArg<unsigned long> {};
+template <> struct FormatArg<unsigned char> : UnsignedArg {};
+template <> struct FormatArg<unsigned short> : UnsignedArg {};
+template <> struct FormatArg<unsigned int> : UnsignedArg {};
+template <> struct FormatArg<unsigned long> : UnsignedArg {};
+template <> struct FormatArg<bool> : UnsignedArg {};
+template <> struct FormatArg<float> : FloatArg {};
+template <> struct FormatArg<double> : FloatArg {};
+template <> struct FormatArg<char> : CharArg {};
+template <> struct FormatArg<char *> : StringArg {};
+template <> struct FormatArg<const char *> : StringArg {};
+template <> struct FormatArg<const __FlashStringHelper *> : FlashStringArg {};
+
+// Compile-time side of nextPlaceholder(), on the literal itself.
+// The '%' of the next placeholder, or the terminating NUL:
+constexpr const char *fmtNext(const char *s) {
+  return *s == '\0'  ? s
+         : *s != '%' ? fmtNext(s + 1)
+         : s[1] == '%' ? fmtNext(s + 2)
+                       : s;
+}
+
+// Conversion character of a placeholder, given the text after its '%'
+constexpr const char *fmtConv(const char *s) {
+  return (*s >= '0' && *s <= '9') || *s == '.' ? fmtConv(s + 1) : s;
+}
+
+// Text following the placeholder at '%' pct
+constexpr const char *fmtAfter(const char *pct) {
+  return *fmtConv(pct + 1) ? fmtConv(pct + 1) + 1 : fmtConv(pct + 1);
+}
+
+constexpr size_t fmtCount(const char *s) {
+  return *fmtNext(s) ? 1 + fmtCount(fmtAfter(fmtNext(s))) : 0;
+}
+
+template <typename... Ts> struct FormatCheck {
+  static constexpr bool ok(const char *) { return true; }
+};
+
+template <typename T, typename... Ts> struct FormatCheck<T, Ts...> {
+  static constexpr bool ok(const char *s) {
+    return *fmtNext(s) == '\0' ||
+           (FormatArg<T>::accepts(*fmtConv(fmtNext(s) + 1)) &&
+            FormatCheck<Ts...>::ok(fmtAfter(fmtNext(s))));
+  }
+};
+
+// Out of line and per kind, so every printf shares the same few
+template <typename Kind>
+__attribute__((noinline)) const char *
+formatOne(FormatSink &sink, const char *p, typename Kind::Value v) {
+  FormatSpec spec = {0, 0, false, 0}; // Zeroed for -Wmaybe-uninitialized only
+  p = nextPlaceholder(sink, p, spec);
+  Kind::format(sink, spec, v);
+  return p;
+}
+
+// Fmt comes from CONSOLE_FMT(): text() is the literal for the checks,
+// flash() its copy in program memory
+template <typename Fmt, typename... Ts>
+size_t printFormat(Print &out, Ts... args) {
+  static_assert(fmtCount(Fmt::text()) == sizeof...(Ts),
+                "Format string and arguments differ in count");
+  static_assert(FormatCheck<Ts...>::ok(Fmt::text()),
+                "Format placeholder doesn't match its argument's type");
+  FormatSink sink(out);
+  const char *p = Fmt::flash();
+  int expand[] = {
+      0, (p = formatOne<typename FormatArg<Ts>::Kind>(sink, p, args), 0)...};
+  (void)expand;
+  FormatSpec tail;
+  nextPlaceholder(sink, p, tail); // Text after the last placeholder
+  return sink.flush();
+}
+
+// --- JSON Lines ---
+// Replies of a session in JSON mode are one object per line, written as
+// they are produced: no document is built and nothing is allocated.
+
+// Writes everything it gets as the inside of a JSON string
+class JsonString : public Print {
+public:
+  JsonString() : _out(nullptr) {}
+
+  void attach(Print &out) { _out = &out; }
+
+  size_t write(uint8_t c) override {
+    if (c == '"' || c == '\\') {
+      _out->write('\\');
+      _out->write(c);
+    } else if (c == '\n') {
+      _out->write("\\n");
+    } else if (c == '\r') {
+      _out->write("\\r");
+    } else if (c == '\t') {
+      _out->write("\\t");
+    } else if (c < 0x20) {
+      _out->write("\\u00");
+      printHex(*_out, c, 2);
+    } else {
+      _out->write(c);
+    }
+    return 1;
+  }
+
+  using Print::write;
+
+private:
+  Print *_out;
+};
+
+// Keys, values and nesting of one reply; only the comma state is kept
+class JsonWriter {
+public:
+  explicit JsonWriter(Print &out) : _out(out), _first(true) {}
+
+  void open(char bracket) {
+    separate();
+    _out.write(bracket);
+    _first = true;
+  }
+
+  void close(char bracket) {
+    _out.write(bracket);
+    _first = false;
+  }
+
+  void key(const __FlashStringHelper *name) {
+    separate();
+    _out.write('"');
+    _out.print(name);
+    _out.write("\":");
+    _first = true;
+  }
+
+  // nullptr is written as null
+  void string(const char *s) {
+    separate();
+    if (!s) {
+      _out.print(F("null"));
+      return;
+    }
+    JsonString str;
+    str.attach(_out);
+    _out.write('"');
+    str.print(s);
+    _out.write('"');
+  }
+
+  void string(const __FlashStringHelper *s) {
+    separate();
+    _out.write('"');
+    _out.print(s);
+    _out.write('"');
+  }
+
+  void number(unsigned long v) {
+    separate();
+    printDec(_out, v);
+  }
+
+  // fixed(1234, 2) writes 12.34
+  void fixed(long scaled, uint8_t decimals) {
+    separate();
+    printFixed(_out, scaled, decimals);
+  }
+
+  void boolean(bool v) {
+    separate();
+    _out.print(v ? F("true") : F("false"));
+  }
+
+  // An open string value, filled by whatever writes into 'str'
+  void beginString(JsonString &str) {
+    separate();
+    _out.write('"');
+    str.attach(_out);
+  }
+
+  void endString() { _out.write('"'); }
+
+private:
+  Print &_out;
+  bool _first;
+
+  void separate() {
+    if (!_first)
+      _out.write(',');
+    _first = false;
+  }
+};
+
+// Per-session state when Config::JSON_LINES is on
+template <bool ENABLED> class JsonSession {
+public:
+  JsonSession() : _on(false), _capturing(false) {}
+
+  bool active() const { return _on; }
+  void setActive(bool on) { _on = on; }
+
+  // While a command runs its output becomes the "out" string
+  Print *captured() { return _capturing ? &_capture : nullptr; }
+
+  void beginCapture(JsonWriter &w) {
+    w.beginString(_capture);
+    _capturing = true;
+  }
+
+  void endCapture(JsonWriter &w) {
+    _capturing = false;
+    w.endString();
+  }
+
+private:
+  bool _on;
+  bool _capturing;
+  JsonString _capture;
+};
+
+template <> class JsonSession<false> {
+public:
+  bool active() const { return false; }
+  void setActive(bool) {}
+  Print *captured() { return nullptr; }
+  void beginCapture(JsonWriter &) {}
+  void endCapture(JsonWriter &) {}
+};
+
+// --- Instrumentation ---
+// What a HardwareSerial RX buffer holds. Finding that much waiting means
+// the buffer was full, and bytes that came in meanwhile are lost.
+#ifdef SERIAL_RX_BUFFER_SIZE
+static const int RX_BUFFER_BYTES = SERIAL_RX_BUFFER_SIZE - 1;
+#else
+static const int RX_BUFFER_BYTES = 63;
+#endif
+
+template <bool ENABLED> struct Instrumentation {
+  ConsoleStats stats;
+
+  Instrumentation() : stats() {}
+
+  void onLine() { stats.lines++; }
+  void onError() { stats.errors++; }
+  void onNak() { stats.naks++; }
+  void onRx(int waiting) {
+    if (waiting > stats.rxPeak)
+      stats.rxPeak = waiting;
+    if (waiting >= RX_BUFFER_BYTES)
+      stats.overruns++;
+  }
+  void onOverrun() { stats.overruns++; }
+  unsigned long begin() { return micros(); }
+  void end(unsigned long start) {
+    unsigned long us = micros() - start;
+    if (us > stats.maxDispatchUs)
+      stats.maxDispatchUs = us;
+  }
+
+  // Body of the built-in "stats" command
+  void print(Print &o) const {
+    o.print(F("lines "));
+    o.print(stats.lines);
+    o.print(F(", errors "));
+    o.print(stats.errors);
+    o.print(F(", naks "));
+    o.print(stats.naks);
+    o.print(F(", max dispatch "));
+    o.print(stats.maxDispatchUs);
+    o.print(F(" us, rx peak "));
+    o.print(stats.rxPeak);
+    o.print(F(", overruns "));
+    o.println(stats.overruns);
+  }
+
+  void writeJson(JsonWriter &w) const {
+    w.key(F("lines"));
+    w.number(stats.lines);
+    w.key(F("errors"));
+    w.number(stats.errors);
+    w.key(F("naks"));
+    w.number(stats.naks);
+    w.key(F("max_dispatch_us"));
+    w.number(stats.maxDispatchUs);
+    w.key(F("rx_peak"));
+    w.number(stats.rxPeak);
+    w.key(F("overruns"));
+    w.number(stats.overruns);
+  }
+};
+
+template <> struct Instrumentation<false> {
+  void onLine() {}
+  void onError() {}
+  void onNak() {}
+  void onRx(int) {}
+  void onOverrun() {}
+  void setDropped(uint16_t) {}
+  unsigned long begin() { return 0; }
+  void end(unsigned long) {}
+  void print(Print &) const {}
+  void writeJson(JsonWriter &) const {}
+};
+
+// --- Bench ---
+// Min, max and average of n timed runs, in microseconds
+struct BenchTiming {
+  unsigned long min, max, total;
+
+  void reset() {
+    min = ~0UL;
+    max = 0;
+    total = 0;
+  }
+
+  void add(unsigned long us) {
+    min = us < min ? us : min;
+    max = us > max ? us : max;
+    total += us;
+  }
+
+  // Average in 1/100 us, without overflowing total * 100
+  long average(unsigned long n) const {
+    return (long)(total / n * 100 + total % n * 100 / n);
+  }
+
+  void print(Print &o, unsigned long n) const {
+    o.print(F(" min "));
+    printDec(o, min);
+    o.print(F(", avg "));
+    printFixed(o, average(n), 2);
+    o.print(F(", max "));
+    printDec(o, max);
+    o.print(F(" us"));
+  }
+
+  void writeJson(JsonWriter &w, unsigned long n) const {
+    w.open('{');
+    w.key(F("min"));
+    w.number(min);
+    w.key(F("avg"));
+    w.fixed(average(n), 2);
+    w.key(F("max"));
+    w.number(max);
+    w.close('}');
+  }
+};
+
+// State of a "bench" line when Config::BENCH is on. count() is 0 unless
+// the current line is one.
+template <bool ENABLED> class Bench {
+public:
+  Bench() : _count(0), _muted(false) {}
+
+  void start(unsigned long n) {
+    _count = n;
+    _parse.reset();
+    _run.reset();
+  }
+  void clear() { _count = 0; }
+  unsigned long count() const { return _count; }
+
+  void addParse(unsigned long us) { _parse.add(us); }
+  void addRun(unsigned long us) { _run.add(us); }
+
+  // The command's output while it's being timed goes nowhere
+  Print *muted() { return _muted ? &_sink : nullptr; }
+  void mute(bool on) { _muted = on; }
+
+  void print(Print &o, const char *name) const {
+    o.print(name);
+    o.print(F(" x"));
+    printDec(o, _count);
+    o.print(F(": parse"));
+    _parse.print(o, _count);
+    o.print(F("; run"));
+    _run.print(o, _count);
+    o.println();
+  }
+
+  void writeJson(JsonWriter &w, const char *name) const {
+    w.key(F("name"));
+    w.string(name);
+    w.key(F("n"));
+    w.number(_count);
+    w.key(F("parse_us"));
+    _parse.writeJson(w, _count);
+    w.key(F("run_us"));
+    _run.writeJson(w, _count);
+  }
+
+private:
+  class NullPrint : public Print {
+  public:
+    size_t write(uint8_t) override { return 1; }
+    size_t write(const uint8_t *, size_t len) override { return len; }
+    using Print::write;
+  };
+
+  unsigned long _count;
+  bool _muted;
+  BenchTiming _parse, _run;
+  NullPrint _sink;
+};
+
+template <> class Bench<false> {
+public:
+  void start(unsigned long) {}
+  void clear() {}
+  unsigned long count() const { return 0; }
+  void addParse(unsigned long) {}
+  void addRun(unsigned long) {}
+  Print *muted() { return nullptr; }
+  void mute(bool) {}
+  void print(Print &, const char *) const {}
+  void writeJson(JsonWriter &, const char *) const {}
+};
+
+// --- Link Test ---
+// "flood" sends a pseudo-random byte stream as fast as the output path
+// takes it, "absorb" checks one coming in. The stream is xorshift16
+// seeded with the pattern argument; see tools/link_test.py.
+static const unsigned long ABSORB_TIMEOUT_US = 1000000;
+
+template <bool ENABLED> class LinkTest {
+public:
+  enum Mode : uint8_t { IDLE, FLOOD, ABSORB };
+
+  LinkTest() : _mode(IDLE) {}
+
+  bool busy() const { return _mode != IDLE; }
+  bool flooding() const { return _mode == FLOOD; }
+  bool absorbing() const { return _mode == ABSORB; }
+
+  void start(Mode mode, unsigned long bytes, uint16_t seed,
+             unsigned long now) {
+    _mode = mode;
+    _bytes = _left = bytes;
+    _x = seed;
+    _errors = 0;
+    _firstUs = _lastUs = now;
+  }
+
+  // Next chunk of a flood, at most n bytes
+  size_t fill(uint8_t *buf, size_t n, unsigned long now) {
+    if (n > _left)
+      n = _left;
+    _lastUs = now;
+    for (size_t i = 0; i < n; i++)
+      buf[i] = next();
+    _left -= n;
+    if (_left == 0)
+      _mode = IDLE;
+    return n;
+  }
+
+  // Checks one absorbed byte; true once all of them arrived
+  bool absorb(uint8_t c, unsigned long now) {
+    if (_left == _bytes)
+      _firstUs = now;
+    _lastUs = now;
+    if (c != next())
+      _errors++;
+    return --_left == 0;
+  }
+
+  // No byte in, or for a flood none out, for ABSORB_TIMEOUT_US
+  bool timedOut(unsigned long now) const {
+    return now - _lastUs >= ABSORB_TIMEOUT_US;
+  }
+
+  void finish() { _mode = IDLE; }
+
+  // The summary; a flood gets one only if it stalled
+  void print(Print &o, bool flood) const {
+    o.print(flood ? F("flood ") : F("absorb "));
+    printDec(o, _bytes - _left);
+    o.print(F(" of "));
+    printDec(o, _bytes);
+    o.print(F(" bytes in "));
+    printDec(o, _lastUs - _firstUs);
+    o.print(F(" us, "));
+    printDec(o, _errors);
+    o.println(F(" errors"));
+  }
+
+  void writeJson(JsonWriter &w, bool flood) const {
+    w.key(flood ? F("sent") : F("received"));
+    w.number(_bytes - _left);
+    w.key(F("bytes"));
+    w.number(_bytes);
+    w.key(F("us"));
+    w.number(_lastUs - _firstUs);
+    w.key(F("errors"));
+    w.number(_errors);
+  }
+
+private:
+  Mode _mode;
+  uint16_t _x;
+  unsigned long _bytes, _left, _errors;
+  unsigned long _firstUs, _lastUs;
+
+  uint8_t next() {
+    _x ^= _x << 7;
+    _x ^= _x >> 9;
+    _x ^= _x << 8;
+    return (uint8_t)_x;
+  }
+};
+
+template <> class LinkTest<false> {
+public:
+  enum Mode : uint8_t { IDLE, FLOOD, ABSORB };
+  bool busy() const { return false; }
+  bool flooding() const { return false; }
+  bool absorbing() const { return false; }
+  void start(Mode, unsigned long, uint16_t, unsigned long) {}
+  size_t fill(uint8_t *, size_t, unsigned long) { return 0; }
+  bool absorb(uint8_t, unsigned long) { return true; }
+  bool timedOut(unsigned long) const { return true; }
+  void finish() {}
+  void print(Print &, bool) const {}
+  void writeJson(JsonWriter &, bool) const {}
+};
+
+// --- Baud Switch ---
+// "baud <rate>" is acknowledged at the old rate, then the port moves and
+// the host has BAUD_CONFIRM_US to send the same line at the new rate.
+// Without it the old rate comes back.
+static const unsigned long BAUD_CONFIRM_US = 2000000;
+
+// Reopens the port at a rate; Stream has no begin()
+typedef void (*BaudHook)(unsigned long baud);
+
+template <bool ENABLED> class BaudSwitch {
+public:
+  BaudSwitch() : _hook(nullptr), _baud(0), _target(0), _sinceUs(0) {}
+
+  void setHook(BaudHook hook, unsigned long baud) {
+    _hook = hook;
+    _baud = baud;
+    _target = 0;
+  }
+
+  bool ready() const { return _hook != nullptr; }
+  bool pending() const { return _target != 0; }
+  unsigned long baud() const { return _baud; }
+  unsigned long target() const { return _target; }
+
+  void start(unsigned long rate, unsigned long now) {
+    _target = rate;
+    _sinceUs = now;
+    _hook(rate);
+  }
+
+  void confirm() {
+    _baud = _target;
+    _target = 0;
+  }
+
+  bool expired(unsigned long now) const {
+    return now - _sinceUs >= BAUD_CONFIRM_US;
+  }
+
+  void fallBack() {
+    _target = 0;
+    _hook(_baud);
+  }
+
+private:
+  BaudHook _hook;
+  unsigned long _baud, _target;
+  unsigned long _sinceUs;
+};
+
+template <> class BaudSwitch<false> {
+public:
+  void setHook(BaudHook, unsigned long) {}
+  bool ready() const { return false; }
+  bool pending() const { return false; }
+  unsigned long baud() const { return 0; }
+  unsigned long target() const { return 0; }
+  void start(unsigned long, unsigned long) {}
+  void confirm() {}
+  bool expired(unsigned long) const { return false; }
+  void fallBack() {}
+};
+
+// --- Out-of-Band Break ---
+// One reserved input byte that never reaches a line; see setBreak()
+template <bool ENABLED> class OutOfBand {
+public:
+  OutOfBand() : _handler(nullptr), _byte(0) {}
+
+  void set(uint8_t c, VoidFuncPtr handler) {
+    _byte = c;
+    _handler = handler;
+  }
+
+  // c as read() returns it, so -1 (no input) never matches
+  bool matches(int c) const { return _handler && c == _byte; }
+  void run() const { _handler(); }
+
+private:
+  VoidFuncPtr _handler;
+  uint8_t _byte;
+};
+
+template <> class OutOfBand<false> {
+public:
+  void set(uint8_t, VoidFuncPtr) {}
+  bool matches(int) const { return false; }
+  void run() const {}
+};
+
+// Input read ahead of the line slots, so the break byte can't hide behind
+// it, or set aside by OutputQueue while it waits for XON. Bytes in here
+// went past the XON/XOFF check but not always the break check.
+template <size_t SIZE, bool ENABLED> class HeldInput {
+public:
+  HeldInput() : _head(0), _count(0) {}
+
+  bool empty() const { return _count == 0; }
+  void clear() { _count = 0; }
+
+  // False if full; the byte is lost then
+  bool push(char c) {
+    if (_count == SIZE)
+      return false;
+    _buf[(_head + _count++) % SIZE] = c;
+    return true;
+  }
+
+  char pop() {
+    char c = _buf[_head];
+    _head = (_head + 1) % SIZE;
+    _count--;
+    return c;
+  }
+
+private:
+  typedef typename conditional<(SIZE <= 255), uint8_t, size_t>::type Pos;
+
+  char _buf[SIZE];
+  Pos _head, _count;
+};
+
+template <size_t SIZE> class HeldInput<SIZE, false> {
+public:
+  bool empty() const { return true; }
+  void clear() {}
+  bool push(char) { return false; }
+  char pop() { return 0; }
+};
+
+// --- Prompts ---
+// Where the next input line goes instead of the command table; see
+// prompt()
+typedef void (*PromptHandler)(const char *reply);
+
+template <bool ENABLED> class Prompt {
+public:
+  Prompt() : _handler(nullptr) {}
+
+  bool waiting() const { return _handler != nullptr; }
+  void set(PromptHandler handler) { _handler = handler; }
+  void cancel() { _handler = nullptr; }
+
+  // Cleared before it runs, so the handler can prompt again
+  PromptHandler take() {
+    PromptHandler h = _handler;
+    _handler = nullptr;
+    return h;
+  }
+
+private:
+  PromptHandler _handler;
+};
+
+template <> class Prompt<false> {
+public:
+  bool waiting() const { return false; }
+  void set(PromptHandler) {}
+  void cancel() {}
+  PromptHandler take() { return nullptr; }
+};
+
+} // namespace console_detail
+
+// =============================================================
+// SECTION 4: TEMPLATE ENGINE (PARSING & VALIDATION)
+// =============================================================
+namespace console_detail {
+
+// --- 0. Line Integrity ---
+inline uint16_t crc16Update(uint16_t crc, uint8_t c) {
+  crc ^= (uint16_t)c << 8;
+  for (uint8_t i = 0; i < 8; i++)
+    crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  return crc;
+}
+
+inline int hexValue(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+// Checks the trailing checksum as bytes arrive, so a completed line needs
+// no second pass
+class LineCheck {
+public:
+  LineCheck() : _mode(INTEGRITY_NONE) { reset(); }
+
+  void setMode(LineIntegrity mode) {
+    _mode = mode;
+    reset();
+  }
+
+  // Returns true if the byte is part of the line body (not the checksum)
+  bool feed(char c) {
+    if (_mode == INTEGRITY_NONE)
+      return true;
+    if (_inField) {
+      int v = hexValue(c);
+      if (v < 0 || ++_digits > width())
+        _bad = true;
+      else
+        _given = (_given << 4) | v;
+      return false;
+    }
+    if (c == '*') {
+      _inField = true;
+      return false;
+    }
+    _sum = _mode == INTEGRITY_NMEA ? _sum ^ (uint8_t)c
+                                   : crc16Update(_sum, (uint8_t)c);
+    return true;
+  }
+
+  // The line didn't fit the buffer, so it can't be trusted either
+  void overflow() { _bad = true; }
+
+  bool verify() const {
+    if (_mode == INTEGRITY_NONE)
+      return true;
+    return _inField && !_bad && _digits == width() && _given == _sum;
+  }
+
+  void reset() {
+    _sum = _mode == INTEGRITY_CRC16 ? 0xFFFF : 0;
+    _given = 0;
+    _digits = 0;
+    _inField = false;
+    _bad = false;
+  }
+
+private:
+  LineIntegrity _mode;
+  uint16_t _sum;
+  uint16_t _given;
+  uint8_t _digits;
+  bool _inField;
+  bool _bad;
+
+  uint8_t width() const { return _mode == INTEGRITY_NMEA ? 2 : 4; }
+};
+
+// Used instead of LineCheck when Config::LINE_INTEGRITY is off
+struct NoLineCheck {
+  void setMode(LineIntegrity) {}
+  bool feed(char) { return true; }
+  void overflow() {}
+  bool verify() const { return true; }
+  void reset() {}
+};
+
+// --- 1. Type Traits (Manual implementation for Arduino compatibility) ---
+template <typename T> struct remove_reference {
+  typedef T type;
+};
+template <typename T> struct remove_reference<T &> {
+  typedef T type;
+};
+template <typename T> struct remove_reference<T &&> {
+  typedef T type;
+};
+
+template <typename T> struct remove_const {
+  typedef T type;
+};
+template <typename T> struct remove_const<const T> {
+  typedef T type;
+};
+
+template <typename T>
+using decay_t = typename remove_const<typename remove_reference<T>::type>::type;
+
+// --- 2. Traits: Parse String -> Type ---
+template <typename T> struct ArgTraits;
+
+template <> struct ArgTraits<int> {
+  static bool parse(const char *str, int &out) {
+    char *end;
+    out = (int)strtol(str, &end, 0);
+    return (str != end && *end == '\0');
+  }
+};
+
+template <> struct ArgTraits<bool> {
+  static bool parse(const char *str, bool &out) {
+    if (strcasecmp(str, "true") == 0 || strcmp(str, "1") == 0) {
+      out = true;
+      return true;
+    }
+    if (strcasecmp(str, "false") == 0 || strcmp(str, "0") == 0) {
+      out = false;
+      return true;
+    }
+    return false;
+  }
+};
+
+template <> struct ArgTraits<long> {
+  static bool parse(const char *str, long &out) {
+    char *end;
+    out = strtol(str, &end, 0);
+    return (str != end && *end == '\0');
+  }
+};
+
+template <> struct ArgTraits<float> {
+  static bool parse(const char *str, float &out) {
+    char *end;
+    out = strtod(str, &end);
+    return (str != end && *end == '\0');
+  }
+};
+
+template <> struct ArgTraits<double> {
+  static bool parse(const char *str, double &out) {
+    char *end;
+    out = strtod(str, &end);
+    return (str != end && *end == '\0');
+  }
+};
+
+template <> struct ArgTraits<char *> {
+  static bool parse(char *str, char *&out) {
+    out = str;
+    return true;
+  }
+};
+
+template <> struct ArgTraits<const char *> {
+  static bool parse(char *str, const char *&out) {
+    out = str;
+    return true;
+  }
+};
+
+// --- 3. Argument Pack: tuple of parsed arguments ---
+template <typename... Args> struct ArgPack;
+
+template <> struct ArgPack<> {
+  bool parse(uint8_t, char *) { return true; }
+};
+
+template <typename Head, typename... Tail> struct ArgPack<Head, Tail...> {
+  Head head;
+  ArgPack<Tail...> tail;
+
+  // Arguments arrive one at a time, so they are parsed by index
+  bool parse(uint8_t index, char *token) {
+    if (index == 0)
+      return ArgTraits<Head>::parse(token, head);
+    return tail.parse(index - 1, token);
+  }
+};
+
+// Aligned storage the console keeps a line's pack in
+template <size_t SIZE> union ArgStore {
+  uint8_t bytes[SIZE];
+  double d;
+  long l;
+  void *p;
+};
+
+// When the last byte of a line came in, for "ping"
+template <bool ENABLED> struct LineTime {
+  unsigned long rxUs;
+  void setRxUs(unsigned long us) { rxUs = us; }
+  unsigned long getRxUs() const { return rxUs; }
+};
+
+template <> struct LineTime<false> {
+  void setRxUs(unsigned long) {}
+  unsigned long getRxUs() const { return 0; }
+};
+
+// One input line and what was parsed out of it so far. Arguments point
+// into buf, so a line stays put from its first byte until its command
+// returns. Positions take a byte when the buffer allows, as each slot
+// pays for them.
+template <size_t BUF, size_t ARGS, bool PING>
+struct InputLine : LineTime<PING> {
+  typedef typename conditional<(BUF <= 256), uint8_t, size_t>::type Pos;
+
+  char buf[BUF];
+  char *badArg; // First argument that failed to parse
+  ArgStore<ARGS> args;
+  int cmdIndex;
+  Pos len;
+  Pos tokenStart;
+  Pos tokenIndex; // 0 = command name, then arguments
+};
+
+// --- 4. Recursive Executor ---
+// Unpacks an ArgPack into a call of anything callable: a function pointer
+// or the lambda itself
+template <typename... Args> struct Executor;
+
+// RECURSIVE STEP: Take Head from the pack, then recurse Tail
+template <typename Head, typename... Tail> struct Executor<Head, Tail...> {
+  template <typename F, typename... Collected>
+  static void run(F &f, const ArgPack<Head, Tail...> &pack,
+                  Collected... collected) {
+    Executor<Tail...>::run(f, pack.tail, collected..., pack.head);
+  }
+};
+
+// BASE CASE: All args collected -> Call function
+template <> struct Executor<> {
+  template <typename F, typename... Collected>
+  static void run(F &f, const ArgPack<> &, Collected... collected) {
+    f(collected...);
+  }
+};
+
+// --- 5. Signatures ---
+// Parser and invoker for one parameter list, as plain static functions so
+// the tables below are constant data
+template <typename F> struct Signature;
+
+template <typename... Args> struct Signature<void (*)(Args...)> {
+  typedef ArgPack<Args...> Pack;
+  static const uint8_t ARGC = sizeof...(Args);
+
+  static bool parse(void *args, uint8_t index, char *token) {
+    return static_cast<Pack *>(args)->parse(index, token);
+  }
+
+  // Type-erased entry point, used by ErasedTable
+  static void invoke(VoidFuncPtr f, const void *args) {
+    auto typedFunc = reinterpret_cast<void (*)(Args...)>(f);
+    call(typedFunc, args);
+  }
+
+  template <typename F> static void call(F &f, const void *args) {
+    Executor<Args...>::run(f, *static_cast<const Pack *>(args));
+  }
+};
+
+// Function pointer types of a command. 'raw' is what the user passed,
+// 'type' has const/ref stripped and is what signatures are keyed on.
+template <typename T>
+struct FuncPtrOf : FuncPtrOf<decltype(&T::operator())> {}; // Lambdas
+
+template <typename... Args> struct FuncPtrOf<void (*)(Args...)> {
+  typedef void (*raw)(Args...);
+  typedef void (*type)(decay_t<Args>...);
+};
+
+template <typename R, typename ClassType, typename... Args>
+struct FuncPtrOf<R (ClassType::*)(Args...) const> {
+  typedef void (*raw)(Args...);
+  typedef void (*type)(decay_t<Args>...);
+};
+
+template <typename R, typename ClassType, typename... Args>
+struct FuncPtrOf<R (ClassType::*)(Args...)> {
+  typedef void (*raw)(Args...);
+  typedef void (*type)(decay_t<Args>...);
+};
+
+// Signature of a command callable
+template <typename F> using SignatureOf = Signature<typename FuncPtrOf<F>::type>;
+
+// --- 6. Flat Packs ---
+// Commands are reached by index through overload resolution and pack
+// expansion instead of recursing once per command, so template depth and
+// compile time stay flat for consoles with hundreds of commands.
+template <size_t... Is> struct IndexSeq {};
+
+template <typename A, typename B> struct JoinSeq;
+
+template <size_t... A, size_t... B>
+struct JoinSeq<IndexSeq<A...>, IndexSeq<B...>> {
+  typedef IndexSeq<A..., (sizeof...(A) + B)...> type;
+};
+
+// 0 .. N-1, built by halving so the depth is log2(N)
+template <size_t N>
+struct MakeSeq : JoinSeq<typename MakeSeq<N / 2>::type,
+                         typename MakeSeq<N - N / 2>::type> {};
+
+template <> struct MakeSeq<0> {
+  typedef IndexSeq<> type;
+};
+template <> struct MakeSeq<1> {
+  typedef IndexSeq<0> type;
+};
+
+template <size_t N> using MakeIndexSeq = typename MakeSeq<N>::type;
+
+// Tuple with one base class per element
+template <size_t I, typename T> struct Indexed {
+  T value;
+};
+
+template <typename Is, typename... Ts> struct FlatTupleOver;
+
+template <size_t... Is, typename... Ts>
+struct FlatTupleOver<IndexSeq<Is...>, Ts...> : Indexed<Is, Ts>... {
+  FlatTupleOver(Ts... ts) : Indexed<Is, Ts>{ts}... {}
+};
+
+template <typename... Ts>
+using FlatTuple = FlatTupleOver<MakeIndexSeq<sizeof...(Ts)>, Ts...>;
+
+// Element I; the compiler deduces T from the one matching base
+template <size_t I, typename T> T &get(Indexed<I, T> &e) { return e.value; }
+
+template <size_t I, typename T> T typeAt(const Indexed<I, T> *); // Not defined
+
+template <size_t I, typename... Ts>
+using TypeAt = decltype(typeAt<I>(static_cast<FlatTuple<Ts...> *>(nullptr)));
+
+template <typename A, typename B> struct IsSame {
+  static const bool value = false;
+};
+template <typename A> struct IsSame<A, A> {
+  static const bool value = true;
+};
+
+// Queries over constexpr arrays. Each halves the range per call, so the
+// constexpr call depth is log2(N) as well.
+constexpr size_t countTrue(const bool *b, size_t lo, size_t hi) {
+  return hi - lo == 0   ? 0
+         : hi - lo == 1 ? (b[lo] ? 1 : 0)
+                        : countTrue(b, lo, (lo + hi) / 2) +
+                              countTrue(b, (lo + hi) / 2, hi);
+}
+
+constexpr size_t firstTrue(const bool *b, size_t lo, size_t hi);
+
+constexpr size_t firstTrueOr(size_t left, const bool *b, size_t mid,
+                             size_t hi) {
+  return left < mid ? left : firstTrue(b, mid, hi);
+}
+
+// Position of the first true in [lo, hi), or hi if there is none
+constexpr size_t firstTrue(const bool *b, size_t lo, size_t hi) {
+  return hi - lo == 0   ? hi
+         : hi - lo == 1 ? (b[lo] ? lo : hi)
+                        : firstTrueOr(firstTrue(b, lo, (lo + hi) / 2), b,
+                                      (lo + hi) / 2, hi);
+}
+
+constexpr size_t nthTrue(const bool *b, size_t lo, size_t hi, size_t n);
+
+constexpr size_t nthTrueSplit(size_t leftCount, const bool *b, size_t lo,
+                              size_t mid, size_t hi, size_t n) {
+  return n < leftCount ? nthTrue(b, lo, mid, n)
+                       : nthTrue(b, mid, hi, n - leftCount);
+}
+
+// Position of the n-th (from 0) true in [lo, hi)
+constexpr size_t nthTrue(const bool *b, size_t lo, size_t hi, size_t n) {
+  return hi - lo <= 1 ? lo
+                      : nthTrueSplit(countTrue(b, lo, (lo + hi) / 2), b, lo,
+                                     (lo + hi) / 2, hi, n);
+}
+
+constexpr size_t maxOf(const size_t *v, size_t lo, size_t hi) {
+  return hi - lo == 0   ? 0
+         : hi - lo == 1 ? v[lo]
+         : maxOf(v, lo, (lo + hi) / 2) > maxOf(v, (lo + hi) / 2, hi)
+             ? maxOf(v, lo, (lo + hi) / 2)
+             : maxOf(v, (lo + hi) / 2, hi);
+}
+
+// --- 7. Signature Set: distinct signatures of a command list ---
+// Ls holds the built-in void(*)() first, then the signature of every
+// command. Only the first occurrence of a type gets a slot in the flash
+// table, commands store the slot index.
+template <typename T, typename... Ls> struct Occurrences {
+  static constexpr bool at[] = {IsSame<T, Ls>::value...};
+};
+
+template <typename T, typename... Ls>
+constexpr bool Occurrences<T, Ls...>::at[];
+
+template <typename Js, typename... Ls> struct SignatureFlags;
+
+template <size_t... Js, typename... Ls>
+struct SignatureFlags<IndexSeq<Js...>, Ls...> {
+  static constexpr bool isFirst[] = {
+      (firstTrue(Occurrences<Ls, Ls...>::at, 0, sizeof...(Ls)) == Js)...};
+  static constexpr size_t packSizes[] = {sizeof(typename Signature<Ls>::Pack)...};
+};
+
+template <size_t... Js, typename... Ls>
+constexpr bool SignatureFlags<IndexSeq<Js...>, Ls...>::isFirst[];
+
+template <size_t... Js, typename... Ls>
+constexpr size_t SignatureFlags<IndexSeq<Js...>, Ls...>::packSizes[];
+
+template <typename... Ls> struct SignatureSet {
+  typedef SignatureFlags<MakeIndexSeq<sizeof...(Ls)>, Ls...> Flags;
+  static const size_t N = sizeof...(Ls);
+
+  static const size_t COUNT = countTrue(Flags::isFirst, 0, N);
+  static const size_t MAX_PACK = maxOf(Flags::packSizes, 0, N);
+
+  // Table slot of the commands of type T
+  template <typename T> struct SlotOf {
+    static const uint8_t value = countTrue(
+        Flags::isFirst, 0, firstTrue(Occurrences<T, Ls...>::at, 0, N));
+  };
+
+  // Signature in table slot S
+  template <size_t S> struct Slot {
+    typedef Signature<TypeAt<nthTrue(Flags::isFirst, 0, N, S), Ls...>> type;
+  };
+};
+
+template <typename Set, typename Ss> struct SignatureTable;
+
+template <typename Set, size_t... Ss>
+struct SignatureTable<Set, IndexSeq<Ss...>> {
+  static const CommandSignature entries[sizeof...(Ss)];
+};
+
+template <typename Set, size_t... Ss>
+const CommandSignature SignatureTable<Set, IndexSeq<Ss...>>::entries[sizeof...(
+    Ss)] PROGMEM = {{&Set::template Slot<Ss>::type::parse,
+                     &Set::template Slot<Ss>::type::invoke,
+                     Set::template Slot<Ss>::type::ARGC}...};
+
+// The flash table of a SignatureSet
+template <typename Set>
+using SignatureEntries = SignatureTable<Set, MakeIndexSeq<Set::COUNT>>;
+
+// --- 8. Command Tables: where the console keeps its commands ---
+// Both tables offer the same interface:
+//   SIZE, name(i), usage(i)     slot count and help texts
+//   select(i)                   the command of the current line
+//   argc(), parse(), invoke()   act on the selected command
+
+// Every function stored as a VoidFuncPtr plus a signature index. One
+// invoker per signature, so code size grows with the number of distinct
+// parameter lists, not with the number of commands.
+template <size_t N> class ErasedTable {
+public:
+  static const size_t SIZE = N;
+
+  // 'table' is the SignatureTable of the command list, in PROGMEM
+  ErasedTable(const CommandSignature *table) : _table(table), _selected(0) {}
+
+  template <typename Sigs, typename TFunc>
+  void set(size_t i, const char *name, TFunc func, const char *usage) {
+    typedef FuncPtrOf<TFunc> Fn;
+    _commands[i].name = name;
+    _commands[i].usage = usage;
+    _commands[i].func = reinterpret_cast<VoidFuncPtr>(
+        static_cast<typename Fn::raw>(func));
+    _signatures[i] = Sigs::template SlotOf<typename Fn::type>::value;
+  }
+
+  const char *name(size_t i) const { return _commands[i].name; }
+  const char *usage(size_t i) const { return _commands[i].usage; }
+
+  void select(size_t i) {
+    _selected = i;
+    memcpy_P(&_sig, &_table[_signatures[i]], sizeof(_sig));
+  }
+
+  uint8_t argc() const { return _sig.argc; }
+
+  bool parse(void *args, uint8_t index, char *token) {
+    return _sig.parser(args, index, token);
+  }
+
+  void invoke(const void *args) {
+    _sig.invoker(_commands[_selected].func, args);
+  }
+
+private:
+  const CommandSignature *_table;
+  Command _commands[N ? N : 1];
+  uint8_t _signatures[N ? N : 1]; // Index into _table per command
+  size_t _selected;
+  CommandSignature _sig; // Copied out of flash by select()
+};
+
+// Every command kept with its own type and called directly through a
+// chain of index compares (g++ -O2 turns it into a jump table, -Os keeps
+// the compares). No casts, and small commands (lambdas especially) inline
+// into the dispatcher; in exchange each command instantiates its own call
+// site.
+template <typename Ks, typename... Fs> class TypedTableOver;
+
+template <size_t... Ks, typename... Fs>
+class TypedTableOver<IndexSeq<Ks...>, Fs...> {
+public:
+  static const size_t SIZE = sizeof...(Fs);
+
+  TypedTableOver(Fs... funcs) : _funcs(funcs...), _selected(0) {}
+
+  void setText(size_t i, const char *name, const char *usage) {
+    _names[i] = name;
+    _usages[i] = usage;
+  }
+
+  const char *name(size_t i) const { return _names[i]; }
+  const char *usage(size_t i) const { return _usages[i]; }
+
+  void select(size_t i) { _selected = i; }
+
+  uint8_t argc() const {
+    static const uint8_t argcs[SIZE ? SIZE : 1] PROGMEM = {
+        SignatureOf<Fs>::ARGC...};
+    return pgm_read_byte(&argcs[_selected]);
+  }
+
+  bool parse(void *args, uint8_t index, char *token) {
+    const size_t i = _selected;
+    bool ok = false;
+    int expand[] = {
+        0, (i == Ks && (ok = SignatureOf<Fs>::parse(args, index, token)))...};
+    (void)expand;
+    return ok;
+  }
+
+  void invoke(const void *args) {
+    const size_t i = _selected;
+    int expand[] = {
+        0, (i == Ks ? (SignatureOf<Fs>::call(get<Ks>(_funcs), args), 0) : 0)...};
+    (void)expand;
+  }
+
+private:
+  const char *_names[SIZE ? SIZE : 1];
+  const char *_usages[SIZE ? SIZE : 1];
+  FlatTuple<Fs...> _funcs;
+  size_t _selected;
+};
+
+template <typename... Fs>
+using TypedTable = TypedTableOver<MakeIndexSeq<sizeof...(Fs)>, Fs...>;
+
+// --- 9. Name Checks ---
+// Bad command names are build errors. Names are plain pointer arguments,
+// so this leans on the optimizer: with string literals (and any -O level,
+// Arduino builds use -Os) every check folds to a constant, and an error
+// function below is only referenced, and so only reported, when its
+// condition is a known true. Names the compiler can't see through are
+// not checked.
+void duplicateCommandName()
+    __attribute__((error("two commands have the same name")));
+void commandNameHasSeparator() __attribute__((
+    error("command name is empty or contains a space, tab, ';' or line end")));
+void commandNameIsBuiltin()
+    __attribute__((error("command name hides a built-in command")));
+
+inline __attribute__((always_inline)) bool sameName(const char *a,
+                                                   const char *b) {
+  return a && b && strcmp(a, b) == 0;
+}
+
+inline __attribute__((always_inline)) const char *asName(const char *s) {
+  return s;
+}
+template <typename T>
+inline __attribute__((always_inline)) const char *asName(const T &) {
+  return nullptr;
+}
+
+// Checks the name at K and compares it with the names after it (names
+// are every third entry). Identical literals share one address, so
+// comparing pointers finds duplicates; the comparisons are branch-free to
+// keep big tables quick to compile. A name can't hold a token separator
+// or a character a terminator set would likely include.
+template <size_t K, typename Config, size_t N, size_t... Js>
+inline __attribute__((always_inline)) void
+checkName(const char *const (&names)[N], IndexSeq<Js...>) {
+  const char *name = names[K];
+  bool blank = !name || name[0] == '\0' || strpbrk(name, " \t\r\n;");
+  bool builtin = (Config::HELP_COMMAND && sameName(name, "help")) ||
+                 (Config::STATS && sameName(name, "stats")) ||
+                 (Config::BENCH && sameName(name, "bench")) ||
+                 (Config::PING && sameName(name, "ping")) ||
+                 (Config::LINK_TEST && (sameName(name, "flood") ||
+                                        sameName(name, "absorb"))) ||
+                 (Config::BAUD_SWITCH && sameName(name, "baud")) ||
+                 (Config::JSON_LINES && sameName(name, "json")) ||
+                 sameName(name, "print_source_code");
+  bool dup = false;
+  int expand[] = {0, (dup |= name == names[K + 3 + 3 * Js])...};
+  (void)expand;
+
+  if (__builtin_constant_p(blank) && blank)
+    commandNameHasSeparator();
+  if (__builtin_constant_p(builtin) && builtin)
+    commandNameIsBuiltin();
+  if (__builtin_constant_p(dup) && dup)
+    duplicateCommandName();
+}
+
+// --- 10. Command List: what the factories derive from their arguments ---
+// Args are the Name, Func, Usage triplets. Built-in commands live in the
+// console, not in the table.
+template <typename Ks, typename... Args> struct CommandListOver;
+
+template <size_t... Ks, typename... Args>
+struct CommandListOver<IndexSeq<Ks...>, Args...> {
+  // void(*)() first keeps the set from being empty
+  typedef SignatureSet<void (*)(), typename FuncPtrOf<
+                                       TypeAt<3 * Ks + 1, Args...>>::type...>
+      Sigs;
+  typedef TypedTable<TypeAt<3 * Ks + 1, Args...>...> Typed;
+
+  template <size_t N>
+  static void fill(ErasedTable<N> &table, FlatTuple<Args...> &args) {
+    int expand[] = {
+        0, (table.template set<Sigs>(Ks, get<3 * Ks>(args),
+                                     get<3 * Ks + 1>(args),
+                                     get<3 * Ks + 2>(args)),
+            0)...};
+    (void)expand;
+  }
+
+  // Inlined into the factory so literal names stay visible. Past
+  // DUPLICATE_CHECK_MAX commands a name is compared with none of the others.
+  template <typename Config>
+  static inline __attribute__((always_inline)) void checkNames(Args... args) {
+    static const bool PAIRS = sizeof...(Ks) <= Config::DUPLICATE_CHECK_MAX;
+    // Every argument, functions as nullptr; names are at 3 * K
+    const char *const all[] = {asName(args)..., nullptr};
+    int expand[] = {
+        0, (checkName<3 * Ks, Config>(
+                all, MakeIndexSeq<PAIRS ? sizeof...(Ks) - Ks - 1 : 0>()),
+            0)...};
+    (void)expand;
+  }
+
+  static Typed makeTyped(FlatTuple<Args...> &args) {
+    Typed table(get<3 * Ks + 1>(args)...);
+    int expand[] = {
+        0, (table.setText(Ks, get<3 * Ks>(args), get<3 * Ks + 2>(args)), 0)...};
+    (void)expand;
+    return table;
+  }
+};
+
+template <typename... Args>
+struct CommandList
+    : CommandListOver<MakeIndexSeq<sizeof...(Args) / 3>, Args...> {
+  static const size_t SIZE = sizeof...(Args) / 3;
+};
+
+} // namespace console_detail
+
+// =============================================================
+// SECTION 5: MAIN CLASS
+// =============================================================
+
+#ifndef SERIAL_CONSOLE_DISABLED
+
+// Table is one of the command tables in console_detail; use the
+// SerialConsole / TypedSerialConsole aliases below rather than naming it.
+template <typename Table, typename Config> class BasicSerialConsole {
+public:
+  BasicSerialConsole(Stream &s, const Table &table)
+      : _stream(s), _out(s, _held), _table(table), _terminators("\r\n"),
+        _idleTimeoutUs(0), _lastByteUs(0), _first(0), _queued(0) {
+    _index.build(_table);
+    for (uint8_t i = 0; i < Config::LINE_SLOTS; i++)
+      resetLine(_lines[i]);
+  }
+
+  // --- Output ---
+  // Commands can print here to share the console's buffered, flow
+  // controlled output path
+  Print &out() {
+    Print *captured = _bench.muted();
+    if (!captured)
+      captured = _json.captured();
+    return captured ? *captured : _out.printer();
+  }
+
+  // Faster than out().print() for numbers, each is a single write()
+  template <typename T> size_t printDec(T v) {
+    return console_detail::printDec(out(), v);
+  }
+  size_t printHex(unsigned long v, uint8_t width = 0) {
+    return console_detail::printHex(out(), v, width);
+  }
+  size_t printFloat(float v, uint8_t decimals = 2) {
+    return console_detail::printFloat(out(), v, decimals);
+  }
+  // printFixed(1234, 2) prints "12.34"
+  size_t printFixed(long scaled, uint8_t decimals) {
+    return console_detail::printFixed(out(), scaled, decimals);
+  }
+
+  // Formatted output, checked at compile time:
+  //   console.printf(CONSOLE_FMT("%d rpm, %.2f V\n"), rpm, volts);
+  template <typename Fmt, typename... Ts> size_t printf(Fmt, Ts... args) {
+    return console_detail::printFormat<Fmt>(out(), args...);
+  }
+
+  void setXonXoff(bool on) {
+    static_assert(Config::FLOW_CONTROL, "Config::FLOW_CONTROL is off");
+    _out.setXonXoff(on);
+  }
+
+  void setCtsPin(int pin) {
+    static_assert(Config::FLOW_CONTROL, "Config::FLOW_CONTROL is off");
+    _out.setCtsPin(pin);
+  }
+
+  // Queued output only goes out as far as the stream's availableForWrite()
+  // reports room, once it has reported any (streams that don't implement
+  // it always say 0). This writes regardless, blocking if need be.
+  void setUncappedOutput(bool on) {
+    static_assert(Config::FLOW_CONTROL, "Config::FLOW_CONTROL is off");
+    _out.setUncapped(on);
+  }
+
+  // --- Line Termination ---
+  // Any of these characters ends a line (default "\r\n")
+  void setTerminators(const char *chars) { _terminators = chars; }
+
+  // End a partial line after this many microseconds without input (0 = off)
+  void setIdleTimeout(unsigned long us) {
+    static_assert(Config::IDLE_TIMEOUT, "Config::IDLE_TIMEOUT is off");
+    _idleTimeoutUs = us;
+  }
+
+  // Require a checksum on every line; failed lines get "NAK" and are
+  // dropped so the host can retransmit
+  void setLineIntegrity(LineIntegrity mode) {
+    static_assert(Config::LINE_INTEGRITY, "Config::LINE_INTEGRITY is off");
+    _check.setMode(mode);
+  }
+
+  // --- Machine Output ---
+  // Reply to every line with one JSON object instead of text; the host
+  // can switch too with "json on" / "json off"
+  void setJsonLines(bool on) {
+    static_assert(Config::JSON_LINES, "Config::JSON_LINES is off");
+    _json.setActive(on);
+  }
+
+  // --- Baud Rate ---
+  // Lets the host move the link with "baud <rate>". 'current' is the rate
+  // the port is open at, which is also the fallback:
+  //   console.setBaudHook([](unsigned long b) { Serial.begin(b); }, 115200);
+  void setBaudHook(console_detail::BaudHook hook, unsigned long current) {
+    static_assert(Config::BAUD_SWITCH, "Config::BAUD_SWITCH is off");
+    _baud.setHook(hook, current);
+  }
+
+  // --- Out-of-Band Break ---
+  // Input byte c (e.g. 0x03, Ctrl-C) never reaches a line. When it comes
+  // in, the partial line, queued output and a running dump or flood are
+  // dropped and 'handler' runs, within one handleInput() call. During
+  // "absorb" it's data like any other byte.
+  void setBreak(char c, VoidFuncPtr handler) {
+    static_assert(Config::OUT_OF_BAND, "Config::OUT_OF_BAND is off");
+    _oob.set((uint8_t)c, handler);
+  }
+
+  // For commands that run long: true once the break came in, after its
+  // handler ran and queued output and input typed ahead of it were
+  // dropped. Other input is held until the console reads it.
+  bool checkBreak() {
+    static_assert(Config::OUT_OF_BAND, "Config::OUT_OF_BAND is off");
+    if (!holdInput())
+      return false;
+    _out.cancel();
+    _prompt.cancel();
+    _oob.run();
+    return true;
+  }
+
+  // --- Prompts ---
+  // For commands that need more input ("erase flash? y/n"): prints text,
+  // and the next line goes to 'handler' instead of running as a command.
+  // The command returns right away and loop() keeps running meanwhile.
+  // The reply comes with separators as single spaces; a handler can
+  // prompt again for the next step. The break byte cancels the prompt.
+  //   void onErase(const char *r) { if (!strcmp(r, "y")) eraseFlash(); }
+  //   void erase() { console.prompt(F("erase flash? y/n"), onErase); }
+  void prompt(const __FlashStringHelper *text,
+              console_detail::PromptHandler handler) {
+    static_assert(Config::PROMPTS, "Config::PROMPTS is off");
+    if (text)
+      out().println(text);
+    _prompt.set(handler);
+  }
+
+  // A prompt waits for its reply
+  bool prompting() const {
+    static_assert(Config::PROMPTS, "Config::PROMPTS is off");
+    return _prompt.waiting();
+  }
+
+  void cancelPrompt() {
+    static_assert(Config::PROMPTS, "Config::PROMPTS is off");
+    _prompt.cancel();
+  }
+
+  // --- Instrumentation ---
+  const ConsoleStats &stats() const {
+    static_assert(Config::STATS, "Config::STATS is off");
+    return _stats.stats;
+  }
+
+  // --- Runtime ---
+  void handleInput() {
+    console_detail::activeOutput() = &out();
+    console_detail::activeJob() = _out.job();
+    _out.pump();
+
+    if (Config::STATS) {
+      _stats.onRx(_stream.available());
+    }
+    // With a break byte or spare slots, input is read even while a dump
+    // or flood runs, so the break gets through and lines queue up
+    if (READ_AHEAD && !_link.absorbing())
+      fillLines();
+    syncRawInput();
+
+    // Keep a running dump in order; new lines wait until it's done
+    if (_out.streaming())
+      return;
+    // Same for a link test, which owns the stream while it runs
+    if (_link.busy()) {
+      serviceLinkTest();
+      return;
+    }
+    if (_baud.pending() && _baud.expired(micros())) {
+      _baud.fallBack();
+      baudReply(_baud.baud(), F("fallback"), false);
+    }
+
+    // Tokens were resolved and parsed while the line arrived; only the
+    // call itself is left. One line per call, the rest wait their turn.
+    if (!READ_AHEAD && readInputLine())
+      _queued = 1;
+    syncRawInput();
+    if (!_queued)
+      return;
+    Line &l = line();
+    if (Config::LINE_SLOTS > 1 && l.cmdIndex >= 0)
+      _table.select(l.cmdIndex);
+    runLine(l);
+    resetLine(l);
+    _bench.clear();
+    _first = (_first + 1) % Config::LINE_SLOTS;
+    _queued--;
+    // Back to the command of the line coming in, if it has one yet
+    if (Config::LINE_SLOTS > 1 && inputLine().cmdIndex >= 0)
+      _table.select(inputLine().cmdIndex);
+    syncRawInput();
+  }
+
+private:
+  typedef console_detail::HeldInput<Config::INPUT_BUF_SIZE,
+                                    Config::OUT_OF_BAND ||
+                                        Config::FLOW_CONTROL>
+      Held;
+
+  typedef typename console_detail::conditional<
+      Config::FLOW_CONTROL,
+      console_detail::OutputQueue<Config::OUTPUT_BUF_SIZE, Held>,
+      console_detail::DirectOutput>::type Output;
+
+  typedef typename console_detail::conditional<
+      Config::LINE_INTEGRITY, console_detail::LineCheck,
+      console_detail::NoLineCheck>::type Check;
+
+  typedef console_detail::InputLine<Config::INPUT_BUF_SIZE,
+                                    Config::ARG_STORE_SIZE, Config::PING>
+      Line;
 
-template <typename T> struct remove_const {
-  typedef T type;
-};
-template <typename T> struct remove_const<const T> {
-  typedef T type;
-};
+  static_assert(Config::LINE_SLOTS > 0, "Config::LINE_SLOTS can't be 0");
+  static const bool READ_AHEAD = Config::OUT_OF_BAND || Config::LINE_SLOTS > 1;
 
-template <typename T>
-using decay_t = typename remove_const<typename remove_reference<T>::type>::type;
+  // Command slot markers for a line that didn't resolve to a table entry
+  enum {
+    CMD_NONE = -1,
+    CMD_UNKNOWN = -2,
+    CMD_HELP = -3,
+    CMD_SOURCE = -4,
+    CMD_STATS = -5,
+    CMD_JSON = -6,
+    CMD_BENCH = -7,
+    CMD_PING = -8,
+    CMD_FLOOD = -9,
+    CMD_ABSORB = -10,
+    CMD_BAUD = -11,
+    CMD_NAK = -12, // Failed its checksum; answered in turn with "NAK"
+  };
 
-// --- 1. Traits: Parse String -> Type ---
-template <typename T> struct ArgTraits;
+  Stream &_stream;
+  Output _out;
+  Table _table;
+  Held _held; // Fills padding when off
+  typename Config::Lookup::template Index<Table::SIZE> _index;
+  console_detail::Prompt<Config::PROMPTS> _prompt; // Fills padding
+  const char *_terminators;
+  unsigned long _idleTimeoutUs;
+  unsigned long _lastByteUs;
+  Check _check;
+  console_detail::OutOfBand<Config::OUT_OF_BAND> _oob; // Fills padding
+  console_detail::Instrumentation<Config::STATS> _stats;
+  // Ring of input lines: _queued complete ones from _first on, then the
+  // one being received
+  uint8_t _first;
+  uint8_t _queued;
 
-template <> struct ArgTraits<int> {
-  static bool parse(const char *str, int &out) {
-    char *end;
-    out = (int)strtol(str, &end, 0);
-    return (str != end && *end == '\0');
+  // Link test, bench and session state; here they fill padding when off
+  console_detail::LinkTest<Config::LINK_TEST> _link;
+  console_detail::BaudSwitch<Config::BAUD_SWITCH> _baud;
+  console_detail::Bench<Config::BENCH> _bench;
+  console_detail::JsonSession<Config::JSON_LINES> _json;
+  Line _lines[Config::LINE_SLOTS];
+
+  // The line the next command comes from, and the one input goes into.
+  // With one slot both are _lines[0], known at compile time.
+  Line &line() { return _lines[Config::LINE_SLOTS > 1 ? _first : 0]; }
+  Line &inputLine() {
+    return _lines[Config::LINE_SLOTS > 1
+                      ? (_first + _queued) % Config::LINE_SLOTS
+                      : 0];
   }
-};
 
-template <> struct ArgTraits<bool> {
-  static bool parse(const char *str, bool &out) {
-    if (strcasecmp(str, "true") == 0 || strcmp(str, "1") == 0) {
-      out = true;
-      return true;
-    }
-    if (strcasecmp(str, "false") == 0 || strcmp(str, "0") == 0) {
-      out = false;
-      return true;
+  // Reads into free slots until the input runs dry. Stops after "absorb",
+  // whose bytes are raw data.
+  void fillLines() {
+    // No slot free: the rest is held, so a break behind it still counts.
+    // Lines that fill the slots in this call run before a break after them.
+    if (_queued == Config::LINE_SLOTS) {
+      if (!absorbQueued() && holdInput())
+        breakNow();
+      return;
     }
-    return false;
+    do {
+      if (absorbQueued() || !readInputLine())
+        return;
+    } while (++_queued < Config::LINE_SLOTS);
   }
-};
 
-template <> struct ArgTraits<long> {
-  static bool parse(const char *str, long &out) {
-    char *end;
-    out = strtol(str, &end, 0);
-    return (str != end && *end == '\0');
+  // Absorbed bytes start right after the line's terminator, so XON/XOFF
+  // are data from then on, even while that line's echo is still queued
+  void syncRawInput() {
+    if (Config::LINK_TEST)
+      _out.setRawInput(absorbQueued() || _link.absorbing());
   }
-};
 
-template <> struct ArgTraits<float> {
-  static bool parse(const char *str, float &out) {
-    char *end;
-    out = strtod(str, &end);
-    return (str != end && *end == '\0');
+  bool absorbQueued() {
+    return Config::LINK_TEST && _queued &&
+           _lines[(_first + _queued - 1) % Config::LINE_SLOTS].cmdIndex ==
+               CMD_ABSORB;
   }
-};
 
-template <> struct ArgTraits<double> {
-  static bool parse(const char *str, double &out) {
-    char *end;
-    out = strtod(str, &end);
-    return (str != end && *end == '\0');
+  // Moves waiting input into _held until the break byte turns up; true
+  // then, with the held input dropped. When _held is full, bytes are
+  // lost (and counted as an overrun) rather than hide the break.
+  bool holdInput() {
+    if (!Config::OUT_OF_BAND)
+      return false;
+    while (_stream.available()) {
+      char c = _stream.read();
+      if (Config::IDLE_TIMEOUT || Config::PING)
+        _lastByteUs = micros();
+      if (_oob.matches((uint8_t)c)) {
+        _held.clear();
+        return true;
+      }
+      if (!_out.filterInput(c) && !_held.push(c))
+        _stats.onOverrun();
+    }
+    return false;
   }
-};
 
-template <> struct ArgTraits<char *> {
-  static bool parse(char *str, char *&out) {
-    out = str;
-    return true;
+  bool readInputLine() {
+    Line &in = inputLine();
+    while (!_held.empty() || _stream.available()) {
+      char c;
+      if (!_held.empty()) {
+        c = _held.pop();
+      } else {
+        c = _stream.read();
+        // Also the receive time "ping" reports, the terminator's
+        if (Config::IDLE_TIMEOUT || Config::PING)
+          _lastByteUs = micros();
+        if (_out.filterInput(c))
+          continue;
+      }
+      // Held bytes too: the output queue holds input unchecked
+      if (_oob.matches((uint8_t)c)) {
+        breakNow();
+        return false;
+      }
+      if (c != '\0' && strchr(_terminators, c)) {
+        if (in.len == 0) {
+          _check.reset();
+          continue;
+        }
+        return finishLine(in);
+      }
+      if (_check.feed(c))
+        ingest(in, c);
+    }
+    // A gap after a partial line ends it as well
+    if (Config::IDLE_TIMEOUT && _idleTimeoutUs && in.len &&
+        micros() - _lastByteUs >= _idleTimeoutUs)
+      return finishLine(in);
+    return false;
   }
-};
 
-template <> struct ArgTraits<const char *> {
-  static bool parse(char *str, const char *&out) {
-    out = str;
-    return true;
+  // Store one byte; a delimiter completes the current token
+  void ingest(Line &in, char c) {
+    if (in.len >= Config::INPUT_BUF_SIZE - 1) {
+      _check.overflow();
+      return;
+    }
+    if (Config::Tokenizer::isDelimiter(c)) {
+      if (in.len > in.tokenStart) {
+        in.buf[in.len++] = '\0';
+        completeToken(in);
+      }
+      return;
+    }
+    in.buf[in.len++] = c;
   }
-};
-
-// --- 2. Recursive Executor ---
-template <typename... Args> struct Executor;
-
-// RECURSIVE STEP: Parse Head, then recurse Tail
-template <typename Head, typename... Tail> struct Executor<Head, Tail...> {
-  template <typename... Collected>
-  static void run(VoidFuncPtr f, const char *name, const char *usage, Stream &s,
-                  Collected... collected) {
 
-    char *token = strtok(NULL, " ");
+  void completeToken(Line &in) {
+    char *token = &in.buf[in.tokenStart];
+    size_t index = in.tokenIndex++;
+    in.tokenStart = in.len;
 
-    if (!token) {
-      s.println(F("Missing argument."));
-      s.print("Usage: ");
-      s.print(name);
-      s.print(" ");
-      s.println(usage ? usage : "");
+    if (index == 0) {
+      in.cmdIndex = findCommand(token);
+      if (in.cmdIndex >= 0)
+        _table.select(in.cmdIndex);
       return;
     }
+    if (in.cmdIndex < 0 || in.badArg || index > _table.argc())
+      return; // Surplus arguments are ignored
+    if (!_table.parse(&in.args, index - 1, token))
+      in.badArg = token;
+  }
 
-    // Prepare variable for parsing
-    // We strip const/ref to declare the local variable 'val'
-    using DecayHead = decay_t<Head>;
-    DecayHead val;
+  // The line is complete; a failed check turns it into a NAK, which is
+  // queued like any line so replies stay in order
+  bool finishLine(Line &in) {
+    in.buf[in.len] = '\0';
+    if (in.len > in.tokenStart)
+      completeToken(in);
+    if (!_check.verify())
+      in.cmdIndex = CMD_NAK;
+    _check.reset();
+    in.setRxUs(_lastByteUs);
+    return true;
+  }
 
-    if (!ArgTraits<DecayHead>::parse(token, val)) {
-      s.print(F("Invalid argument '"));
-      s.print(token);
-      s.println(F("'."));
-      s.print("Usage: ");
-      s.print(name);
-      s.print(" ");
-      s.println(usage ? usage : "");
+  // One complete line: echo, dispatch, stats
+  void runLine(Line &l) {
+    if (l.cmdIndex == CMD_NAK) {
+      _stats.onNak();
+      if (_json.active())
+        out().println(F("{\"ok\":false,\"error\":\"nak\"}"));
+      else
+        out().println(F("NAK"));
+      return;
+    }
+    // After a switch, only the confirmation counts; the rest is most
+    // likely noise from the change
+    if (_baud.pending()) {
+      confirmBaud();
       return;
     }
 
-    Executor<Tail...>::run(f, name, usage, s, collected..., val);
-  }
-};
+    _stats.onLine();
+    // A ping is answered first thing, without the echo in front
+    bool reply = _prompt.waiting();
+    if (Config::ECHO_LINES && !_json.active() &&
+        !(Config::PING && l.cmdIndex == CMD_PING && !reply))
+      echoLine();
 
-// BASE CASE: All args parsed -> Call function
-template <> struct Executor<> {
-  template <typename... Collected>
-  static void run(VoidFuncPtr f, const char *n, const char *u, Stream &s,
-                  Collected... collected) {
-    auto typedFunc = reinterpret_cast<void (*)(Collected...)>(f);
-    typedFunc(collected...);
+    unsigned long start = _stats.begin();
+    if (reply)
+      answerPrompt(l);
+    else
+      dispatch();
+    _stats.end(start);
   }
-};
 
-// --- 3. Command Binder ---
-template <typename T> struct CommandBinder;
+  // The whole line goes to the prompt's handler, whatever its first word
+  void answerPrompt(Line &l) {
+    console_detail::PromptHandler handler = _prompt.take();
+    // Token separators are NULs by now
+    size_t len = l.len;
+    while (len > 0 && l.buf[len - 1] == '\0')
+      len--;
+    for (size_t i = 0; i < len; i++)
+      if (l.buf[i] == '\0')
+        l.buf[i] = ' ';
+    l.buf[len] = '\0';
 
-// Specialization A: Standard Function Pointers
-template <typename... Args> struct CommandBinder<void (*)(Args...)> {
-  static void bind(Command &cmd, void (*func)(Args...)) {
-    cmd.func = reinterpret_cast<VoidFuncPtr>(func);
-    cmd.invoker = [](VoidFuncPtr f, const char *n, const char *u, Stream &s) {
-      Executor<Args...>::run(f, n, u, s);
-    };
+    if (!_json.active()) {
+      handler(l.buf);
+      _out.pump();
+      return;
+    }
+    Print &o = _out.printer();
+    console_detail::JsonWriter w(o);
+    w.open('{');
+    w.key(F("reply"));
+    w.string(l.buf);
+    w.key(F("ok"));
+    w.boolean(true);
+    w.key(F("out"));
+    _json.beginCapture(w);
+    handler(l.buf);
+    _json.endCapture(w);
+    writePromptFlag(w);
+    w.close('}');
+    o.println();
+    _out.pump();
   }
-};
 
-// Specialization B: Lambdas / Functors
-template <typename T> struct CommandBinder {
-  // Helper to extract args from the operator() pointer (const)
-  template <typename R, typename ClassType, typename... Args>
-  static void bindInternal(Command &cmd, T lambda,
-                           R (ClassType::*)(Args...) const) {
-    using FuncPtrType = void (*)(Args...);
-    FuncPtrType rawFunc = static_cast<FuncPtrType>(lambda);
-    CommandBinder<FuncPtrType>::bind(cmd, rawFunc);
+  // Tells a JSON host that the next line is a reply, not a command
+  void writePromptFlag(console_detail::JsonWriter &w) {
+    if (!_prompt.waiting())
+      return;
+    w.key(F("prompt"));
+    w.boolean(true);
   }
 
-  // Helper for non-const operator()
-  template <typename R, typename ClassType, typename... Args>
-  static void bindInternal(Command &cmd, T lambda, R (ClassType::*)(Args...)) {
-    using FuncPtrType = void (*)(Args...);
-    FuncPtrType rawFunc = static_cast<FuncPtrType>(lambda);
-    CommandBinder<FuncPtrType>::bind(cmd, rawFunc);
+  // The break byte: everything in flight goes, then the handler runs
+  void breakNow() {
+    for (uint8_t i = 0; i < Config::LINE_SLOTS; i++)
+      resetLine(_lines[i]);
+    _first = _queued = 0;
+    _held.clear();
+    _check.reset();
+    _out.cancel();
+    _link.finish();
+    _prompt.cancel();
+    _oob.run();
   }
 
-  static void bind(Command &cmd, T lambda) {
-    bindInternal(cmd, lambda, &T::operator());
+  void resetLine(Line &l) {
+    l.len = 0;
+    l.tokenStart = 0;
+    l.tokenIndex = 0;
+    l.cmdIndex = CMD_NONE;
+    l.badArg = nullptr;
   }
-};
 
-} // namespace console_detail
+  // Built-ins first. Which ones exist is fixed at build time: the config
+  // flags at compile time, print_source_code when the linker resolves the
+  // weak symbol, i.e. EMBED_SOURCE_CODE() is used.
+  int findCommand(const char *token) {
+    if (Config::HELP_COMMAND && strcmp(token, "help") == 0)
+      return CMD_HELP;
+    if (Config::STATS && strcmp(token, "stats") == 0)
+      return CMD_STATS;
+    if (Config::BENCH && strcmp(token, "bench") == 0)
+      return CMD_BENCH;
+    if (Config::PING && strcmp(token, "ping") == 0)
+      return CMD_PING;
+    if (Config::LINK_TEST && strcmp(token, "flood") == 0)
+      return CMD_FLOOD;
+    if (Config::LINK_TEST && strcmp(token, "absorb") == 0)
+      return CMD_ABSORB;
+    if (Config::BAUD_SWITCH && strcmp(token, "baud") == 0)
+      return CMD_BAUD;
+    if (Config::JSON_LINES && strcmp(token, "json") == 0)
+      return CMD_JSON;
+    if (print_embedded_source_code &&
+        strcmp(token, "print_source_code") == 0)
+      return CMD_SOURCE;
+    int i = _index.find(_table, token);
+    return i >= 0 ? i : CMD_UNKNOWN;
+  }
 
-// =============================================================
-// SECTION 3: MAIN CLASS
-// =============================================================
+  void echoLine() {
+    Line &l = line();
+    // Token separators are NULs by now
+    size_t len = l.len;
+    while (len > 0 && l.buf[len - 1] == '\0')
+      len--;
+    Print &o = out();
+    o.print(F("> "));
+    for (size_t i = 0; i < len; i++)
+      o.print(l.buf[i] ? l.buf[i] : ' ');
+    o.println();
+  }
 
-template <size_t N_CMDS> class SerialConsole {
-public:
-  SerialConsole(Stream &s) : _stream(s) {}
+  void dispatch() {
+    Line &l = line();
+    if (Config::JSON_LINES && l.cmdIndex == CMD_JSON) {
+      // "json" alone or "json on" starts JSON Lines, "json off" ends it.
+      // Acknowledged in JSON whenever the session was or will be in it.
+      const char *arg = l.tokenIndex > 1 ? l.buf + strlen(l.buf) + 1
+                                        : "on";
+      bool on = strcmp(arg, "off") != 0;
+      if (on || _json.active())
+        out().println(F("{\"cmd\":\"json\",\"ok\":true}"));
+      _json.setActive(on);
+      return;
+    }
+    if (Config::PING && l.cmdIndex == CMD_PING) {
+      pong();
+      return;
+    }
+    if (Config::LINK_TEST &&
+        (l.cmdIndex == CMD_FLOOD || l.cmdIndex == CMD_ABSORB)) {
+      startLinkTest();
+      return;
+    }
+    if (Config::BAUD_SWITCH && l.cmdIndex == CMD_BAUD) {
+      switchBaud();
+      return;
+    }
+    if (Config::BENCH && l.cmdIndex == CMD_BENCH && !prepareBench())
+      return;
+    if (_json.active()) {
+      dispatchJson();
+      return;
+    }
 
-  // --- Initialization ---
-  void initArgs(size_t i) {}
+    Print &o = out();
+    switch (l.cmdIndex) {
+    case CMD_HELP:
+      if (Config::HELP_COMMAND)
+        printHelp();
+      return;
+    case CMD_STATS:
+      _stats.print(o);
+      return;
+    case CMD_SOURCE:
+      print_embedded_source_code();
+      _out.pump();
+      return;
+    }
+    if (l.cmdIndex < 0) {
+      _stats.onError();
+      if (Config::ERROR_TEXT >= ERRORS_TERSE)
+        o.println(F("Unknown command."));
+      return;
+    }
 
-  template <typename TFunc, typename... Rest>
-  void initArgs(size_t i, const char *name, TFunc func, const char *usage,
-                Rest... rest) {
-    if (i >= N_CMDS)
+    if (l.badArg) {
+      _stats.onError();
+      if (Config::ERROR_TEXT >= ERRORS_TERSE) {
+        o.print(F("Invalid argument '"));
+        o.print(l.badArg);
+        o.println(F("'."));
+      }
+      if (Config::ERROR_TEXT >= ERRORS_VERBOSE)
+        printUsage(l.cmdIndex);
+      return;
+    }
+    if (l.tokenIndex - 1 < _table.argc()) {
+      _stats.onError();
+      if (Config::ERROR_TEXT >= ERRORS_TERSE)
+        o.println(F("Missing argument."));
+      if (Config::ERROR_TEXT >= ERRORS_VERBOSE)
+        printUsage(l.cmdIndex);
       return;
+    }
 
-    _commands[i].name = name;
-    _commands[i].usage = usage;
+    // The echo goes out first, in case the command writes to the stream
+    // directly
+    _out.drainAll();
+    invoke();
+    if (_bench.count())
+      _bench.print(o, _table.name(l.cmdIndex));
+    _out.pump();
+  }
+
+  // The command, or n timed runs of it for "bench", with output muted
+  void invoke() {
+    Line &l = line();
+    unsigned long n = _bench.count();
+    if (!n) {
+      _table.invoke(&l.args);
+      return;
+    }
+    _bench.mute(true);
+    unsigned long t = micros();
+    for (unsigned long i = 0; i < n; i++) {
+      _table.invoke(&l.args);
+      unsigned long now = micros();
+      _bench.addRun(now - t);
+      t = now;
+    }
+    _bench.mute(false);
+  }
 
-    console_detail::CommandBinder<TFunc>::bind(_commands[i], func);
+  // "bench <n> <name> <args...>": looks the command up and parses its
+  // arguments n times, timing each, and leaves the line state as if
+  // "<name> <args...>" had arrived alone. False, with the error reported,
+  // if n is missing or bad or the command is a built-in.
+  bool prepareBench() {
+    Line &l = line();
+    if (l.tokenIndex < 3) {
+      builtinArgError(F("bench"), F("<n> <command line>"));
+      return false;
+    }
+    char *count = l.buf + strlen(l.buf) + 1;
+    char *name = count + strlen(count) + 1;
+    long n;
+    if (!console_detail::ArgTraits<long>::parse(count, n) || n <= 0) {
+      l.badArg = count;
+      builtinArgError(F("bench"), F("<n> <command line>"));
+      return false;
+    }
+    int builtin = findCommand(name);
+    if (builtin < 0 && builtin != CMD_UNKNOWN) {
+      benchBuiltinError(name);
+      return false;
+    }
+    size_t tokens = l.tokenIndex - 2; // The name and its arguments
+    _bench.start(n);
+    unsigned long t = micros();
+    for (long i = 0; i < n; i++) {
+      parseAlone(name, tokens);
+      unsigned long now = micros();
+      _bench.addParse(now - t);
+      t = now;
+    }
+    l.tokenIndex = tokens;
+    return true;
+  }
 
-    initArgs(i + 1, rest...);
+  // What completeToken() does as a line arrives, on a complete one.
+  // Table commands only; prepareBench() turns built-ins away first.
+  void parseAlone(char *name, size_t tokens) {
+    Line &l = line();
+    l.badArg = nullptr;
+    l.cmdIndex = _index.find(_table, name);
+    if (l.cmdIndex < 0) {
+      l.cmdIndex = CMD_UNKNOWN;
+      return;
+    }
+    _table.select(l.cmdIndex);
+    char *arg = name;
+    for (size_t k = 1; k < tokens && k <= _table.argc() && !l.badArg; k++) {
+      arg += strlen(arg) + 1;
+      if (!_table.parse(&l.args, k - 1, arg))
+        l.badArg = arg;
+    }
   }
 
-  void addDynamicCommand(size_t i, const char *name, void (*func)(),
-                         const char *usage) {
-    if (i >= N_CMDS)
+  // Reply to "ping <seq> <host_ts>": both arguments as they came, then
+  // when the line was read and when the reply was written, in micros()
+  void pong() {
+    Line &l = line();
+    if (l.tokenIndex < 3) {
+      builtinArgError(F("ping"), F("<seq> <host_ts>"));
       return;
-    _commands[i].name = name;
-    _commands[i].usage = usage;
-    if (func) {
-      console_detail::CommandBinder<void (*)()>::bind(_commands[i], func);
+    }
+    char *seq = l.buf + strlen(l.buf) + 1;
+    char *hostTs = seq + strlen(seq) + 1;
+    Print &o = out();
+    unsigned long txUs = micros();
+    if (_json.active()) {
+      console_detail::JsonWriter w(o);
+      w.open('{');
+      w.key(F("cmd"));
+      w.string(F("ping"));
+      w.key(F("ok"));
+      w.boolean(true);
+      w.key(F("seq"));
+      w.string(seq);
+      w.key(F("host_ts"));
+      w.string(hostTs);
+      w.key(F("rx_us"));
+      w.number(l.getRxUs());
+      w.key(F("tx_us"));
+      w.number(txUs);
+      w.close('}');
     } else {
-      _commands[i].func = nullptr; // Safety nulling
+      o.print(F("pong "));
+      o.print(seq);
+      o.print(' ');
+      o.print(hostTs);
+      o.print(' ');
+      console_detail::printDec(o, l.getRxUs());
+      o.print(' ');
+      console_detail::printDec(o, txUs);
     }
+    o.println();
+    _out.pump();
   }
 
-  // --- Runtime ---
-  void handleInput() {
-    if (!readInputLine())
+  // "flood|absorb <bytes> <pattern>"; the stream runs from the next
+  // handleInput() on. An absorbed stream starts right after this line's
+  // terminator.
+  void startLinkTest() {
+    Line &l = line();
+    bool flood = l.cmdIndex == CMD_FLOOD;
+    if (l.tokenIndex < 3) {
+      linkTestArgError(flood);
+      return;
+    }
+    char *bytes = l.buf + strlen(l.buf) + 1;
+    char *pattern = bytes + strlen(bytes) + 1;
+    long n, seed;
+    if (!console_detail::ArgTraits<long>::parse(bytes, n) || n <= 0)
+      l.badArg = bytes;
+    else if (!console_detail::ArgTraits<long>::parse(pattern, seed) ||
+             (uint16_t)seed == 0)
+      l.badArg = pattern;
+    if (l.badArg) {
+      linkTestArgError(flood);
       return;
+    }
+    typedef console_detail::LinkTest<Config::LINK_TEST> Link;
+    _link.start(flood ? Link::FLOOD : Link::ABSORB, n, (uint16_t)seed,
+                micros());
+  }
 
-    _stream.print(F("> "));
-    _stream.println(_inputBuf);
+  void linkTestArgError(bool flood) {
+    builtinArgError(flood ? F("flood") : F("absorb"), F("<bytes> <pattern>"));
+  }
 
-    char *token = strtok(_inputBuf, " ");
-    if (!token)
+  // One step of a flood or absorb, without ever waiting on the link
+  void serviceLinkTest() {
+    if (_link.flooding()) {
+      Print &o = _out.printer();
+      uint8_t chunk[16];
+      // At most one queue's worth per call, even with uncapped output. A
+      // stream without an output queue that reports no room (it may not
+      // know) gets one chunk, written blocking.
+      int budget = o.availableForWrite();
+      if (!Config::FLOW_CONTROL && budget == 0)
+        budget = sizeof(chunk);
+      while (_link.flooding() && budget > 0) {
+        int room = o.availableForWrite();
+        if (!Config::FLOW_CONTROL && room == 0)
+          room = budget;
+        if (room <= 0)
+          break;
+        if (room > budget)
+          room = budget;
+        size_t n = room < (int)sizeof(chunk) ? room : sizeof(chunk);
+        budget -= n;
+        o.write(chunk, _link.fill(chunk, n, micros()));
+        _out.pump();
+      }
+      // Held off for too long: what's still queued is dropped so the
+      // summary gets out
+      if (_link.flooding() && _link.timedOut(micros())) {
+        _out.cancel();
+        finishLinkTest(true);
+      }
       return;
+    }
+    // Raw bytes: no terminators, and XON/XOFF are data here
+    bool done = false;
+    while (!done && (!_held.empty() || _stream.available()))
+      done = _link.absorb(_held.empty() ? _stream.read() : _held.pop(),
+                          micros());
+    if (done || _link.timedOut(micros()))
+      finishLinkTest(false);
+  }
 
-    if (strcmp(token, "help") == 0) {
-      printHelp();
-      return;
+  void finishLinkTest(bool flood) {
+    _link.finish();
+    syncRawInput();
+    Print &o = out();
+    if (_json.active()) {
+      console_detail::JsonWriter w(o);
+      w.open('{');
+      w.key(F("cmd"));
+      w.string(flood ? F("flood") : F("absorb"));
+      w.key(F("ok"));
+      w.boolean(true);
+      _link.writeJson(w, flood);
+      w.close('}');
+      o.println();
+    } else {
+      _link.print(o, flood);
     }
+    _out.pump();
+  }
 
-    for (size_t i = 0; i < N_CMDS; i++) {
-      if (strcmp(token, _commands[i].name) == 0) {
-        if (!_commands[i].name)
-          continue;
-        _commands[i].invoker(_commands[i].func, _commands[i].name,
-                             _commands[i].usage, _stream);
-        return;
-      }
+  // Rate of a "baud <rate>" line, 0 if it has none or a bad one
+  unsigned long baudArg() {
+    Line &l = line();
+    if (l.tokenIndex < 2)
+      return 0;
+    char *arg = l.buf + strlen(l.buf) + 1;
+    long rate;
+    if (!console_detail::ArgTraits<long>::parse(arg, rate) || rate <= 0) {
+      l.badArg = arg;
+      return 0;
     }
-    _stream.println(F("Unknown command."));
+    return rate;
   }
 
-private:
-  Stream &_stream;
-  Command _commands[N_CMDS];
-  char _inputBuf[INPUT_BUF_SIZE];
+  // The acknowledgement has to be out at the old rate before the switch,
+  // so this is the one reply that waits for the link
+  void switchBaud() {
+    unsigned long rate = baudArg();
+    if (!rate) {
+      builtinArgError(F("baud"), F("<rate>"));
+      return;
+    }
+    if (!_baud.ready()) {
+      _stats.onError();
+      baudReply(rate, F("unsupported"), false);
+      return;
+    }
+    baudReply(rate, F("pending"), true);
+    _out.printer().flush();
+    _baud.start(rate, micros());
+  }
 
-  bool readInputLine() {
-    if (_stream.available() == 0)
-      return false;
-    static int idx = 0;
-    while (_stream.available()) {
-      char c = _stream.read();
-      if (c == '\n' || c == '\r') {
-        if (idx == 0)
-          continue;
-        _inputBuf[idx] = '\0';
-        idx = 0;
-        return true;
+  void confirmBaud() {
+    Line &l = line();
+    if (l.cmdIndex != CMD_BAUD || baudArg() != _baud.target())
+      return;
+    _baud.confirm();
+    baudReply(_baud.baud(), F("ok"), true);
+  }
+
+  // "baud <rate> <state>", or {"cmd":"baud","ok":..,"baud":..,"state":..}
+  void baudReply(unsigned long rate, const __FlashStringHelper *state,
+                 bool ok) {
+    Print &o = out();
+    if (_json.active()) {
+      console_detail::JsonWriter w(o);
+      w.open('{');
+      w.key(F("cmd"));
+      w.string(F("baud"));
+      w.key(F("ok"));
+      w.boolean(ok);
+      w.key(F("baud"));
+      w.number(rate);
+      w.key(F("state"));
+      w.string(state);
+      w.close('}');
+    } else {
+      o.print(F("baud "));
+      console_detail::printDec(o, rate);
+      o.print(' ');
+      o.print(state);
+    }
+    o.println();
+    _out.pump();
+  }
+
+  // A built-in's own arguments are missing or bad
+  void builtinArgError(const __FlashStringHelper *name,
+                       const __FlashStringHelper *usage) {
+    _stats.onError();
+    Line &l = line();
+    Print &o = out();
+    if (_json.active()) {
+      console_detail::JsonWriter w(o);
+      w.open('{');
+      w.key(F("cmd"));
+      w.string(name);
+      w.key(F("ok"));
+      w.boolean(false);
+      w.key(F("error"));
+      if (l.badArg) {
+        w.string(F("invalid argument"));
+        w.key(F("arg"));
+        w.string(l.badArg);
+      } else {
+        w.string(F("missing argument"));
       }
-      if (idx < INPUT_BUF_SIZE - 1) {
-        _inputBuf[idx++] = c;
+      if (Config::ERROR_TEXT >= ERRORS_VERBOSE) {
+        w.key(F("usage"));
+        w.string(usage);
       }
+      w.close('}');
+      o.println();
+      return;
     }
-    return false;
+    if (Config::ERROR_TEXT >= ERRORS_TERSE) {
+      if (l.badArg) {
+        o.print(F("Invalid argument '"));
+        o.print(l.badArg);
+        o.println(F("'."));
+      } else {
+        o.println(F("Missing argument."));
+      }
+    }
+    if (Config::ERROR_TEXT >= ERRORS_VERBOSE) {
+      o.print(F("Usage: "));
+      o.print(name);
+      o.print(' ');
+      o.println(usage);
+    }
+  }
+
+  // "bench <n> help" and the like: built-ins print straight away and
+  // can't be muted or timed
+  void benchBuiltinError(const char *name) {
+    _stats.onError();
+    Print &o = out();
+    if (_json.active()) {
+      console_detail::JsonWriter w(o);
+      w.open('{');
+      w.key(F("cmd"));
+      w.string(F("bench"));
+      w.key(F("ok"));
+      w.boolean(false);
+      w.key(F("error"));
+      w.string(F("built-in command"));
+      w.key(F("arg"));
+      w.string(name);
+      w.close('}');
+      o.println();
+    } else if (Config::ERROR_TEXT >= ERRORS_TERSE) {
+      o.print(F("Built-in commands can't be timed: '"));
+      o.print(name);
+      o.println(F("'."));
+    }
+  }
+
+  void printUsage(size_t i) {
+    Print &o = out();
+    const char *usage = _table.usage(i);
+    o.print(F("Usage: "));
+    o.print(_table.name(i));
+    o.print(F(" "));
+    o.println(usage ? usage : "");
   }
 
   void printHelp() {
-    for (size_t i = 0; i < N_CMDS; i++) {
-      if (!_commands[i].name)
-        continue;
-      _stream.print(F("  "));
-      _stream.print(_commands[i].name);
-      if (_commands[i].usage) {
-        _stream.print(F(" "));
-        _stream.print(_commands[i].usage);
+    for (size_t i = 0; i < Table::SIZE; i++)
+      printHelpLine(_table.name(i), _table.usage(i));
+    if (print_embedded_source_code)
+      printHelpLine("print_source_code", "print source code");
+    if (Config::STATS)
+      printHelpLine("stats", nullptr);
+    if (Config::BENCH)
+      printHelpLine("bench", "<n> <command line>");
+    if (Config::PING)
+      printHelpLine("ping", "<seq> <host_ts>");
+    if (Config::LINK_TEST) {
+      printHelpLine("flood", "<bytes> <pattern>");
+      printHelpLine("absorb", "<bytes> <pattern>");
+    }
+    if (Config::BAUD_SWITCH)
+      printHelpLine("baud", "<rate>");
+    if (Config::JSON_LINES)
+      printHelpLine("json", "on|off");
+  }
+
+  void printHelpLine(const char *name, const char *usage) {
+    Print &o = out();
+    o.print(F("  "));
+    o.print(name);
+    if (usage) {
+      o.print(F(" "));
+      o.print(usage);
+    }
+    o.println();
+  }
+
+  // Same outcomes as dispatch(), as {"cmd":..., "ok":...} plus the
+  // command's output in "out" or the reason in "error"
+  void dispatchJson() {
+    Line &l = line();
+    _out.drainAll(); // Earlier replies before anything the command writes
+    Print &o = _out.printer();
+    console_detail::JsonWriter w(o);
+    w.open('{');
+    w.key(F("cmd"));
+    w.string(l.buf);
+    w.key(F("ok"));
+
+    if (l.cmdIndex >= 0 && !l.badArg && l.tokenIndex - 1 >= _table.argc()) {
+      w.boolean(true);
+      if (_bench.count()) {
+        invoke();
+        _bench.writeJson(w, _table.name(l.cmdIndex));
+      } else {
+        w.key(F("out"));
+        _json.beginCapture(w);
+        _table.invoke(&l.args);
+        _json.endCapture(w);
+        writePromptFlag(w);
+      }
+    } else if (l.cmdIndex == CMD_HELP && Config::HELP_COMMAND) {
+      w.boolean(true);
+      writeSchema(w);
+    } else if (l.cmdIndex == CMD_STATS) {
+      w.boolean(true);
+      _stats.writeJson(w);
+    } else if (l.cmdIndex == CMD_SOURCE) {
+      // Streamed synchronously so the string can be closed after it
+      w.boolean(true);
+      w.key(F("out"));
+      _json.beginCapture(w);
+      console_detail::activeOutput() = &out();
+      console_detail::activeJob() = nullptr;
+      print_embedded_source_code();
+      _json.endCapture(w);
+    } else {
+      _stats.onError();
+      w.boolean(false);
+      w.key(F("error"));
+      if (l.cmdIndex < 0) {
+        w.string(F("unknown command"));
+      } else {
+        if (l.badArg) {
+          w.string(F("invalid argument"));
+          w.key(F("arg"));
+          w.string(l.badArg);
+        } else {
+          w.string(F("missing argument"));
+        }
+        if (Config::ERROR_TEXT >= ERRORS_VERBOSE) {
+          w.key(F("usage"));
+          w.string(_table.usage(l.cmdIndex));
+        }
       }
-      _stream.println();
     }
+    w.close('}');
+    o.println();
+    _out.pump();
+  }
+
+  // Reply to "help" in JSON mode: every command with its argument count
+  void writeSchema(console_detail::JsonWriter &w) {
+    w.key(F("commands"));
+    w.open('[');
+    for (size_t i = 0; i < Table::SIZE; i++) {
+      _table.select(i);
+      writeSchemaEntry(w, _table.name(i), _table.usage(i), _table.argc());
+    }
+    if (print_embedded_source_code)
+      writeSchemaEntry(w, "print_source_code", "print source code", 0);
+    if (Config::STATS)
+      writeSchemaEntry(w, "stats", nullptr, 0);
+    if (Config::BENCH)
+      writeSchemaEntry(w, "bench", "<n> <command line>", 2);
+    if (Config::PING)
+      writeSchemaEntry(w, "ping", "<seq> <host_ts>", 2);
+    if (Config::LINK_TEST) {
+      writeSchemaEntry(w, "flood", "<bytes> <pattern>", 2);
+      writeSchemaEntry(w, "absorb", "<bytes> <pattern>", 2);
+    }
+    if (Config::BAUD_SWITCH)
+      writeSchemaEntry(w, "baud", "<rate>", 1);
+    writeSchemaEntry(w, "json", "on|off", 1);
+    w.close(']');
+  }
+
+  void writeSchemaEntry(console_detail::JsonWriter &w, const char *name,
+                        const char *usage, uint8_t argc) {
+    w.open('{');
+    w.key(F("name"));
+    w.string(name);
+    w.key(F("argc"));
+    w.number(argc);
+    w.key(F("usage"));
+    w.string(usage);
+    w.close('}');
+  }
+};
+
+#else // SERIAL_CONSOLE_DISABLED
+
+// Release build stub: same interface, no behaviour. Nothing keeps the
+// command names, usage strings or invokers alive, so the linker drops
+// them; command output through out() still reaches the stream.
+template <typename Table, typename Config> class BasicSerialConsole {
+public:
+  BasicSerialConsole(Stream &s, const Table &) : _stream(s) {}
+
+  Print &out() { return _stream; }
+  template <typename T> size_t printDec(T v) {
+    return console_detail::printDec(_stream, v);
+  }
+  size_t printHex(unsigned long v, uint8_t width = 0) {
+    return console_detail::printHex(_stream, v, width);
+  }
+  size_t printFloat(float v, uint8_t decimals = 2) {
+    return console_detail::printFloat(_stream, v, decimals);
+  }
+  size_t printFixed(long scaled, uint8_t decimals) {
+    return console_detail::printFixed(_stream, scaled, decimals);
   }
+  template <typename Fmt, typename... Ts> size_t printf(Fmt, Ts... args) {
+    return console_detail::printFormat<Fmt>(_stream, args...);
+  }
+  void setXonXoff(bool) {}
+  void setCtsPin(int) {}
+  void setUncappedOutput(bool) {}
+  void setTerminators(const char *) {}
+  void setIdleTimeout(unsigned long) {}
+  void setLineIntegrity(LineIntegrity) {}
+  void setJsonLines(bool) {}
+  void setBaudHook(console_detail::BaudHook, unsigned long) {}
+  void setBreak(char, VoidFuncPtr) {}
+  bool checkBreak() { return false; }
+  void prompt(const __FlashStringHelper *, console_detail::PromptHandler) {}
+  bool prompting() const { return false; }
+  void cancelPrompt() {}
+
+  const ConsoleStats &stats() const {
+    static const ConsoleStats none = ConsoleStats();
+    return none;
+  }
+
+  void handleInput() {}
+
+private:
+  Stream &_stream;
 };
 
+#endif // SERIAL_CONSOLE_DISABLED
+
+// Type-erased commands: one shared invoker per distinct parameter list
+template <size_t N_CMDS, typename Config = DefaultConsoleConfig>
+using SerialConsole =
+    BasicSerialConsole<console_detail::ErasedTable<N_CMDS>, Config>;
+
+// Typed commands, called directly; see createTypedConsole()
+template <typename Config, typename... Args>
+using TypedSerialConsole =
+    BasicSerialConsole<typename console_detail::CommandList<Args...>::Typed,
+                       Config>;
+
 // =============================================================
-// SECTION 4: FACTORY FUNCTIONS
+// SECTION 6: FACTORY FUNCTIONS
 // =============================================================
+namespace console_detail {
 
-template <typename... Args>
-SerialConsole<(sizeof...(Args) / 3) + 1> createConsole(Args... args) {
-  static_assert(sizeof...(Args) % 3 == 0,
-                "Args must be triplets: Name, Func, Usage");
+template <typename Config, typename... Args>
+SerialConsole<CommandList<Args...>::SIZE, Config>
+buildConsole(Stream &s, Args... args) {
+  typedef CommandList<Args...> List;
+  typedef typename List::Sigs Sigs;
+  static_assert(Sigs::MAX_PACK <= Config::ARG_STORE_SIZE,
+                "Command arguments don't fit Config::ARG_STORE_SIZE");
 
-  // Allocate space for the user commands + 1 extra for the potential print_code
-  SerialConsole<(sizeof...(Args) / 3) + 1> c(Serial);
-  c.initArgs(0, args...);
+  ErasedTable<List::SIZE> table(SignatureEntries<Sigs>::entries);
+  FlatTuple<Args...> argTuple(args...);
+  List::fill(table, argTuple);
+  return SerialConsole<List::SIZE, Config>(s, table);
+}
 
-  // Magic detection: If the macro was used, this pointer evaluates to true
-  if (print_embedded_source_code) {
-    c.addDynamicCommand(sizeof...(Args) / 3, "print_source_code",
-                        print_embedded_source_code, "print source code");
-  } else {
-    c.addDynamicCommand(sizeof...(Args) / 3, nullptr, nullptr, nullptr);
-  }
+template <typename Config, typename... Args>
+BasicSerialConsole<typename CommandList<Args...>::Typed, Config>
+buildTypedConsole(Stream &s, Args... args) {
+  typedef CommandList<Args...> List;
+  static_assert(List::Sigs::MAX_PACK <= Config::ARG_STORE_SIZE,
+                "Command arguments don't fit Config::ARG_STORE_SIZE");
 
-  return c;
+  FlatTuple<Args...> argTuple(args...);
+  typename List::Typed table = List::makeTyped(argTuple);
+  return BasicSerialConsole<typename List::Typed, Config>(s, table);
 }
 
-template <typename... Args>
-SerialConsole<(sizeof...(Args) / 3) + 1> createConsoleStream(Stream &s,
-                                                             Args... args) {
+} // namespace console_detail
+
+// The public factories are always inlined into the caller so the name
+// checks see the literals; the console itself is built out of line.
+
+template <typename Config = DefaultConsoleConfig, typename... Args>
+inline __attribute__((always_inline))
+SerialConsole<console_detail::CommandList<Args...>::SIZE, Config>
+createConsoleStream(Stream &s, Args... args) {
   static_assert(sizeof...(Args) % 3 == 0,
                 "Args must be triplets: Name, Func, Usage");
+  if (Config::NAME_CHECKS)
+    console_detail::CommandList<Args...>::template checkNames<Config>(
+        args...);
+  return console_detail::buildConsole<Config>(s, args...);
+}
 
-  // Allocate space for the user commands + 1 extra for the potential
-  // print_code
-  SerialConsole<(sizeof...(Args) / 3) + 1> c(s);
-  c.initArgs(0, args...);
+template <typename Config = DefaultConsoleConfig, typename... Args>
+inline __attribute__((always_inline))
+SerialConsole<console_detail::CommandList<Args...>::SIZE, Config>
+createConsole(Args... args) {
+  return createConsoleStream<Config>(Serial, args...);
+}
 
-  // Magic detection: If the macro was used, this pointer evaluates to true
-  if (print_embedded_source_code) {
-    c.addDynamicCommand(sizeof...(Args) / 3, "print_source_code",
-                        print_embedded_source_code, "print source code");
-  } else {
-    c.addDynamicCommand(sizeof...(Args) / 3, nullptr, nullptr, nullptr);
-  }
+// Same arguments as createConsole, but every command keeps its own type
+// and is called directly instead of through a cast function pointer.
+// Trivial getters and setters inline into the dispatcher; the cost is one
+// call site per command rather than one per signature.
+template <typename Config = DefaultConsoleConfig, typename... Args>
+inline __attribute__((always_inline)) TypedSerialConsole<Config, Args...>
+createTypedConsoleStream(Stream &s, Args... args) {
+  static_assert(sizeof...(Args) % 3 == 0,
+                "Args must be triplets: Name, Func, Usage");
+  if (Config::NAME_CHECKS)
+    console_detail::CommandList<Args...>::template checkNames<Config>(
+        args...);
+  return console_detail::buildTypedConsole<Config>(s, args...);
+}
 
-  return c;
+template <typename Config = DefaultConsoleConfig, typename... Args>
+inline __attribute__((always_inline)) TypedSerialConsole<Config, Args...>
+createTypedConsole(Args... args) {
+  return createTypedConsoleStream<Config>(Serial, args...);
 }
 
 #endif
 
+// Format string for console.printf(). A local type carries the literal so
+// printf can check it at compile time; only the flash copy is emitted.
+#define CONSOLE_FMT(s)                                                         \
+  (__extension__({                                                             \
+    struct ConsoleFormat {                                                     \
+      static constexpr const char *text() { return s; }                        \
+      static const char *flash() { return PSTR(s); }                           \
+    };                                                                         \
+    ConsoleFormat();                                                           \
+  }))
+
+#ifdef SERIAL_CONSOLE_DISABLED
+// Nothing to print the source with, so don't burn it into flash either
+#define EMBED_SOURCE_CODE()
+#else
 #define EMBED_SOURCE_CODE()                                                    \
   extern "C" {                                                                 \
   __asm__(".pushsection .progmem.data, \"a\"\n"                                \
@@ -371,13 +3437,7 @@ SerialConsole<(sizeof...(Args) / 3) + 1> createConsoleStream(Stream &s,
   extern const char embedded_source_code[] PROGMEM;                            \
   extern const char embedded_source_end[] PROGMEM;                             \
   void print_embedded_source_code() {                                          \
-    const char *ptr = embedded_source_code;                                    \
-    while (ptr < embedded_source_end) {                                        \
-      char c = pgm_read_byte(ptr);                                             \
-      if (c == 0)                                                              \
-        break;                                                                 \
-      Serial.print(c);                                                         \
-      ptr++;                                                                   \
-    }                                                                          \
+    console_detail::streamProgmem(embedded_source_code, embedded_source_end);  \
   }                                                                            \
   }
+#endif
@@ -0,0 +1,227 @@
+// Host benchmark of the console's number formatting (printDec, printHex,
+// printFloat, printFixed) against the digit-by-digit approach of the
+// Arduino core's Print::printNumber() / printFloat().
+//
+//   cd extras/bench
+//   g++ -O2 -I../host -I../../SerialConsole format_bench.cpp ../host/Arduino.cpp
+//   ./a.out [iterations]
+//
+// Prints ns per number for each case. Host CPUs divide quickly; on AVR,
+// where a 32-bit division is a libgcc loop, the gap is much wider. First
+// checks that both sides print the same text for every test value, and
+// fails if they don't.
+#include "SerialConsole.h"
+
+#include <string>
+
+// =============================================================
+// SECTION 1: SINK & REFERENCE IMPLEMENTATION
+// =============================================================
+
+// Counts and checksums output so nothing gets optimized away
+class Sink : public Print {
+public:
+  unsigned long bytes = 0;
+  unsigned long sum = 0;
+
+  size_t write(uint8_t c) override {
+    bytes++;
+    sum = sum * 31 + c;
+    return 1;
+  }
+
+  size_t write(const uint8_t *buf, size_t len) override {
+    for (size_t i = 0; i < len; i++)
+      sum = sum * 31 + buf[i];
+    bytes += len;
+    return len;
+  }
+
+  using Print::write;
+};
+
+// Keeps the text, for comparing the two sides
+class TextSink : public Print {
+public:
+  std::string text;
+
+  size_t write(uint8_t c) override {
+    text += (char)c;
+    return 1;
+  }
+
+  using Print::write;
+};
+
+// One division per digit, as in the Arduino core
+size_t naiveNumber(Print &p, unsigned long n, uint8_t base) {
+  char buf[8 * sizeof(long) + 1];
+  char *s = &buf[sizeof(buf) - 1];
+  *s = '\0';
+  do {
+    char c = (char)(n % base);
+    n /= base;
+    *--s = c < 10 ? c + '0' : c + 'A' - 10;
+  } while (n);
+  return p.write(s);
+}
+
+size_t naiveDec(Print &p, long n) {
+  if (n < 0) {
+    size_t t = p.write('-');
+    return t + naiveNumber(p, 0UL - (unsigned long)n, 10);
+  }
+  return naiveNumber(p, (unsigned long)n, 10);
+}
+
+// Rounds, prints the integer part, then one digit (and one write) per
+// decimal, as in the Arduino core
+size_t naiveFloat(Print &p, double number, uint8_t digits) {
+  size_t n = 0;
+  if (isnan(number))
+    return p.write("nan");
+  if (isinf(number))
+    return p.write("inf");
+  if (number > 4294967040.0 || number < -4294967040.0)
+    return p.write("ovf");
+  if (number < 0.0) {
+    n += p.write('-');
+    number = -number;
+  }
+  double rounding = 0.5;
+  for (uint8_t i = 0; i < digits; ++i)
+    rounding /= 10.0;
+  number += rounding;
+  unsigned long whole = (unsigned long)number;
+  double remainder = number - (double)whole;
+  n += naiveNumber(p, whole, 10);
+  if (digits > 0)
+    n += p.write('.');
+  while (digits-- > 0) {
+    remainder *= 10.0;
+    unsigned int d = (unsigned int)remainder;
+    n += naiveNumber(p, d, 10);
+    remainder -= d;
+  }
+  return n;
+}
+
+// =============================================================
+// SECTION 2: CASES
+// =============================================================
+
+static const size_t N_VALUES = 1024;
+static long values[N_VALUES];
+static float floats[N_VALUES];
+
+// Deterministic xorshift, so runs are comparable
+static void fillValues(uint32_t seed) {
+  for (size_t i = 0; i < N_VALUES; i++) {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    values[i] = (long)(int32_t)seed;
+    floats[i] = (float)(int32_t)seed / 65536.0f;
+  }
+}
+
+struct Case {
+  const char *name;
+  long mask; // Applied to the test values to pick a magnitude
+  void (*naive)(Print &, size_t);
+  void (*fast)(Print &, size_t);
+  bool same; // Both sides print the same text
+};
+
+#define VALUE(i) (values[(i) % N_VALUES] & c_mask)
+static long c_mask;
+
+static void naiveDecCase(Print &p, size_t i) { naiveDec(p, VALUE(i)); }
+static void fastDecCase(Print &p, size_t i) {
+  console_detail::printDec(p, VALUE(i));
+}
+static void naiveHexCase(Print &p, size_t i) {
+  naiveNumber(p, (unsigned long)VALUE(i), 16);
+}
+static void fastHexCase(Print &p, size_t i) {
+  console_detail::printHex(p, (unsigned long)VALUE(i), 0);
+}
+static void naiveFloat2Case(Print &p, size_t i) {
+  naiveFloat(p, floats[i % N_VALUES], 2);
+}
+static void fastFloat2Case(Print &p, size_t i) {
+  console_detail::printFloat(p, floats[i % N_VALUES], 2);
+}
+static void naiveFloat5Case(Print &p, size_t i) {
+  naiveFloat(p, floats[i % N_VALUES], 5);
+}
+static void fastFloat5Case(Print &p, size_t i) {
+  console_detail::printFloat(p, floats[i % N_VALUES], 5);
+}
+// The fixed-point alternative: the same readings kept as 1/100 units
+static void fastFixedCase(Print &p, size_t i) {
+  console_detail::printFixed(p, VALUE(i), 2);
+}
+
+static const Case cases[] = {
+    {"dec 0..99", 0x3F, naiveDecCase, fastDecCase, true},
+    {"dec 16-bit", 0xFFFF, naiveDecCase, fastDecCase, true},
+    {"dec 32-bit", -1L, naiveDecCase, fastDecCase, true},
+    {"hex 32-bit", 0xFFFFFFFFL, naiveHexCase, fastHexCase, true},
+    {"float .2", 0, naiveFloat2Case, fastFloat2Case, true},
+    {"float .5", 0, naiveFloat5Case, fastFloat5Case, true},
+    {"fixed .2 (vs float)", 0xFFFFFF, naiveFloat2Case, fastFixedCase, false},
+};
+
+// =============================================================
+// SECTION 3: MAIN
+// =============================================================
+
+// Number of test values the two sides print differently; shows the first
+static size_t mismatches(const Case &c) {
+  size_t n = 0;
+  for (size_t i = 0; i < N_VALUES; i++) {
+    TextSink a, b;
+    c.naive(a, i);
+    c.fast(b, i);
+    if (a.text != b.text && n++ == 0)
+      fprintf(stderr, "%s: \"%s\" vs \"%s\"\n", c.name, a.text.c_str(),
+              b.text.c_str());
+  }
+  return n;
+}
+
+static double nsPerOp(void (*fn)(Print &, size_t), size_t iters, Sink &sink) {
+  unsigned long start = micros();
+  for (size_t i = 0; i < iters; i++)
+    fn(sink, i);
+  return (micros() - start) * 1000.0 / iters;
+}
+
+int main(int argc, char **argv) {
+  size_t iters = argc > 1 ? strtoul(argv[1], nullptr, 10) : 2000000;
+  fillValues(2463534242u);
+
+  printf("%-20s %10s %10s %8s\n", "case", "naive ns", "fast ns", "speedup");
+  unsigned long check = 0;
+  size_t wrong = 0;
+  for (const Case &c : cases) {
+    c_mask = c.mask;
+    if (c.same)
+      wrong += mismatches(c);
+  }
+  if (wrong) {
+    fprintf(stderr, "%zu values print differently\n", wrong);
+    return 1;
+  }
+  for (const Case &c : cases) {
+    c_mask = c.mask;
+    Sink a, b;
+    double slow = nsPerOp(c.naive, iters, a);
+    double fast = nsPerOp(c.fast, iters, b);
+    printf("%-20s %10.1f %10.1f %7.2fx\n", c.name, slow, fast, slow / fast);
+    check += a.sum + b.sum;
+  }
+  fprintf(stderr, "checksum %lx\n", check);
+  return 0;
+}
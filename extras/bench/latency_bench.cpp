@@ -0,0 +1,145 @@
+// End-of-line-to-execution latency of the console under scheduled byte
+// arrival (line rate, bursts, gaps, line endings). Runs on the virtual
+// clock, so every run prints the same numbers.
+//
+//   cd extras/bench
+//   g++ -O2 -I../host -I../../SerialConsole latency_bench.cpp ../host/Arduino.cpp
+//   ./a.out
+//
+// loop() is modelled as handleInput() plus "loop us" of other work. The
+// latency of a line runs from the arrival of the byte that ends it (the
+// first terminator byte, or the last byte for idle-timeout lines) to the
+// command reading micros(). Console CPU time isn't included; the clock
+// only moves between loop() calls.
+#include "SerialConsole.h"
+#include "MockStream.h"
+
+#include <string>
+
+static const int LINES = 8;
+static const unsigned long NOT_RUN = ~0UL;
+
+static MockStream mock;
+static unsigned long executedAt[LINES];
+
+void mark(int seq) {
+  if (seq >= 0 && seq < LINES)
+    executedAt[seq] = micros();
+}
+
+struct BenchConfig : DefaultConsoleConfig {
+  static const bool ECHO_LINES = false;
+  static const bool FLOW_CONTROL = true;
+  static const bool IDLE_TIMEOUT = true;
+};
+
+auto console = createConsoleStream<BenchConfig>(mock, "mark", mark, "seq");
+
+// =============================================================
+// SECTION 1: SCHEDULES
+// =============================================================
+
+struct Schedule {
+  const char *name;
+  unsigned long baud;    // 0: all lines arrive in one burst
+  const char *eol;       // "" ends lines by idle timeout only
+  unsigned long loopUs;  // Time between handleInput() calls
+  unsigned long midUs;   // Pause in the middle of each line
+  unsigned long afterUs; // Pause after each line
+  unsigned long idleUs;  // Idle timeout, 0 = off
+};
+
+static const Schedule schedules[] = {
+    {"9600 CRLF", 9600, "\r\n", 100, 0, 0, 0},
+    {"115200 CRLF", 115200, "\r\n", 100, 0, 0, 0},
+    {"1M CRLF", 1000000, "\r\n", 100, 0, 0, 0},
+    {"115200 LF", 115200, "\n", 100, 0, 0, 0},
+    {"115200 CR", 115200, "\r", 100, 0, 0, 0},
+    {"115200 CRLF, fast loop", 115200, "\r\n", 10, 0, 0, 0},
+    {"115200 CRLF, slow loop", 115200, "\r\n", 1000, 0, 0, 0},
+    {"1M CRLF, slow loop", 1000000, "\r\n", 1000, 0, 0, 0},
+    {"burst of 8 lines", 0, "\n", 100, 0, 0, 0},
+    {"3 ms gap mid-line", 115200, "\n", 100, 3000, 0, 0},
+    {"3 ms gap, 2 ms timeout", 115200, "\n", 100, 3000, 0, 2000},
+    {"no EOL, 2 ms timeout", 115200, "", 100, 0, 5000, 2000},
+};
+
+// Queues the lines; ends[] gets the arrival of the byte ending each line
+static void queueLines(const Schedule &s, unsigned long ends[]) {
+  mock.setBaud(s.baud);
+  std::string all;
+  for (int i = 0; i < LINES; i++) {
+    std::string line = "mark " + std::to_string(i);
+    if (s.baud == 0) {
+      all += line + s.eol;
+      continue;
+    }
+    size_t half = line.size() / 2;
+    ends[i] = mock.feed(line.substr(0, half));
+    if (s.midUs)
+      mock.gap(s.midUs);
+    ends[i] = mock.feed(line.substr(half));
+    if (*s.eol) {
+      ends[i] = mock.feed(std::string(1, s.eol[0]));
+      mock.feed(s.eol + 1);
+    }
+    if (s.afterUs)
+      mock.gap(s.afterUs);
+  }
+  if (s.baud == 0) {
+    unsigned long at = mock.burst(all);
+    for (int i = 0; i < LINES; i++)
+      ends[i] = at;
+  }
+}
+
+// =============================================================
+// SECTION 2: MAIN
+// =============================================================
+
+static void run(const Schedule &s) {
+  unsigned long ends[LINES];
+  for (int i = 0; i < LINES; i++)
+    executedAt[i] = NOT_RUN;
+  console.setIdleTimeout(s.idleUs);
+  queueLines(s, ends);
+
+  // Until everything arrived and had a second to be handled
+  unsigned long stop = ends[LINES - 1] + 1000000;
+  while ((long)(micros() - stop) < 0) {
+    console.handleInput();
+    advanceMicros(s.loopUs);
+  }
+  // End whatever a lost line left behind, so the next schedule is clean
+  mock.burst("\n");
+  for (int i = 0; i < 4; i++)
+    console.handleInput();
+  mock.takeOutput();
+
+  unsigned long lo = NOT_RUN, hi = 0, sum = 0;
+  int done = 0;
+  for (int i = 0; i < LINES; i++) {
+    if (executedAt[i] == NOT_RUN)
+      continue;
+    unsigned long us = executedAt[i] - ends[i];
+    lo = us < lo ? us : lo;
+    hi = us > hi ? us : hi;
+    sum += us;
+    done++;
+  }
+  if (done)
+    printf("%-24s %7lu %7lu %7lu %7lu %5d\n", s.name, s.loopUs, lo,
+           sum / done, hi, LINES - done);
+  else
+    printf("%-24s %7lu %7s %7s %7s %5d\n", s.name, s.loopUs, "-", "-", "-",
+           LINES);
+}
+
+int main() {
+  useVirtualClock(true);
+  printf("%-24s %7s %7s %7s %7s %5s\n", "schedule", "loop us", "min us",
+         "avg us", "max us", "lost");
+  for (const Schedule &s : schedules)
+    run(s);
+  return 0;
+}
@@ -0,0 +1,369 @@
+// Request/response latency and throughput of the console over a real
+// pseudo-terminal. A child process runs the console on the slave end;
+// the parent drives it from the master end and prints one CSV row per
+// mode and payload size:
+//
+//   mode,payload,requests,lost,p50_us,p90_us,p99_us,max_us,cmds_per_s,bytes_per_s
+//
+//   cd extras/bench
+//   g++ -O2 -I../host -I../../SerialConsole pty_bench.cpp ../host/Arduino.cpp
+//   ./a.out [requests [mode]] > pty.csv
+//
+// Every request is "echo <payload>" and the reply is the payload. Latency
+// is measured one request at a time; throughput with up to WINDOW
+// requests in flight. Modes:
+//   text   default config, the console echoes every line
+//   quiet  ECHO_LINES off, only the reply
+//   json   JSON Lines session, one object per reply
+//   mux    quiet, framed as ConsoleMux channel 0 (stuffed, with CRC)
+// A request whose reply doesn't come within TIMEOUT_MS counts as lost;
+// "lost" is the larger count of the two runs.
+#include "SerialConsole.h"
+#include "ConsoleMux.h"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <string>
+#include <sys/wait.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+static const int WINDOW = 8;
+static const int TIMEOUT_MS = 500;
+static const int MAX_LOST = 10; // Then the latency run gives up
+static const size_t PAYLOADS[] = {1, 16, 48};
+
+// =============================================================
+// SECTION 1: CONSOLE SIDE
+// =============================================================
+
+struct QuietConfig : DefaultConsoleConfig {
+  static const bool ECHO_LINES = false;
+  static const bool FLOW_CONTROL = true;
+};
+
+struct JsonConfig : QuietConfig {
+  static const bool JSON_LINES = true;
+};
+
+// console.out() of the running console. It has to be fetched while the
+// command runs: in a JSON session that's what captures the output.
+static Print &(*reply)();
+
+void echo(const char *text) { reply().println(text); }
+
+// A host loop() with nothing else to do sleeps until input arrives, so
+// the driver gets the CPU on small machines
+static void waitForInput(HardwareSerial &port, int fd) {
+  pollfd p = {fd, POLLIN, 0};
+  if (!port.available())
+    poll(&p, 1, TIMEOUT_MS);
+}
+
+static void serveText(HardwareSerial &port, int fd) {
+  static auto console = createConsoleStream(port, "echo", echo, "text");
+  reply = []() -> Print & { return console.out(); };
+  for (;;) {
+    waitForInput(port, fd);
+    console.handleInput();
+  }
+}
+
+static void serveQuiet(HardwareSerial &port, int fd) {
+  static auto console =
+      createConsoleStream<QuietConfig>(port, "echo", echo, "text");
+  reply = []() -> Print & { return console.out(); };
+  for (;;) {
+    waitForInput(port, fd);
+    console.handleInput();
+  }
+}
+
+static void serveJson(HardwareSerial &port, int fd) {
+  static auto console =
+      createConsoleStream<JsonConfig>(port, "echo", echo, "text");
+  reply = []() -> Print & { return console.out(); };
+  console.setJsonLines(true);
+  for (;;) {
+    waitForInput(port, fd);
+    console.handleInput();
+  }
+}
+
+static void serveMux(HardwareSerial &port, int fd) {
+  static ConsoleMux<1> mux(port);
+  static auto console =
+      createConsoleStream<QuietConfig>(mux.channel(0), "echo", echo, "text");
+  reply = []() -> Print & { return console.out(); };
+  mux.channel(0).setLineFlush(true);
+  for (;;) {
+    if (!mux.channel(0).available())
+      waitForInput(port, fd);
+    mux.poll();
+    console.handleInput();
+  }
+}
+
+struct Mode {
+  const char *name;
+  void (*serve)(HardwareSerial &, int fd);
+  int lines;   // Reply lines per request
+  bool framed; // ConsoleMux frames both ways
+};
+
+static const Mode MODES[] = {
+    {"text", serveText, 2, false},
+    {"quiet", serveQuiet, 1, false},
+    {"json", serveJson, 1, false},
+    {"mux", serveMux, 1, true},
+};
+
+// =============================================================
+// SECTION 2: DRIVER SIDE
+// =============================================================
+
+static unsigned long long nowNs() {
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+class Driver {
+public:
+  Driver(int fd, const Mode &mode)
+      : _fd(fd), _mode(mode), _lines(0), _state(0), _left(0), _ch(0),
+        _escaped(false), _written(0), _read(0) {}
+
+  void send(const std::string &line) {
+    std::string wire = _mode.framed ? frame(line) : line;
+    for (size_t done = 0; done < wire.size();) {
+      ssize_t n = write(_fd, wire.data() + done, wire.size() - done);
+      if (n > 0)
+        done += n;
+    }
+    _written += wire.size();
+  }
+
+  // Waits for one reply; false after TIMEOUT_MS
+  bool receive() {
+    while (_lines < _mode.lines) {
+      pollfd p = {_fd, POLLIN, 0};
+      if (poll(&p, 1, TIMEOUT_MS) <= 0)
+        return false;
+      char buf[4096];
+      ssize_t n = read(_fd, buf, sizeof(buf));
+      for (ssize_t i = 0; i < n; i++)
+        decode((uint8_t)buf[i]);
+      _read += n > 0 ? n : 0;
+    }
+    _lines -= _mode.lines;
+    return true;
+  }
+
+  // After a lost reply: end any partial line and drop what's in flight
+  void resync() {
+    send("\n");
+    usleep(TIMEOUT_MS * 1000);
+    char buf[4096];
+    pollfd p = {_fd, POLLIN, 0};
+    while (poll(&p, 1, 0) > 0 && read(_fd, buf, sizeof(buf)) > 0) {
+    }
+    _lines = _state = _left = 0;
+    _escaped = false;
+  }
+
+  unsigned long long bytes() const { return _written + _read; }
+
+private:
+  int _fd;
+  const Mode &_mode;
+  int _lines; // Complete reply lines not consumed yet
+  int _state, _left, _ch;
+  bool _escaped;
+  unsigned long long _written, _read;
+
+  static void stuff(std::string &out, uint8_t c) {
+    if (c == MUX_SOF || c == MUX_ESC) {
+      out += (char)MUX_ESC;
+      c ^= 0x20;
+    }
+    out += (char)c;
+  }
+
+  // Channel 0 frames of at most MUX_RX_BUF_SIZE - 1 bytes each
+  static std::string frame(const std::string &line) {
+    std::string wire;
+    for (size_t i = 0; i < line.size(); i += MUX_RX_BUF_SIZE - 1) {
+      std::string chunk = line.substr(i, MUX_RX_BUF_SIZE - 1);
+      uint8_t crc = console_detail::muxCrc8(0, 0);
+      crc = console_detail::muxCrc8(crc, (uint8_t)chunk.size());
+      wire += (char)MUX_SOF;
+      stuff(wire, 0);
+      stuff(wire, (uint8_t)chunk.size());
+      for (char c : chunk) {
+        crc = console_detail::muxCrc8(crc, (uint8_t)c);
+        stuff(wire, (uint8_t)c);
+      }
+      stuff(wire, crc);
+    }
+    return wire;
+  }
+
+  // Counts reply lines, unwrapping channel 0 frames in mux mode. The CRC
+  // isn't checked; a pty doesn't lose bytes.
+  void decode(uint8_t c) {
+    if (!_mode.framed) {
+      _lines += c == '\n';
+      return;
+    }
+    if (c == MUX_SOF) {
+      _state = 1;
+      _escaped = false;
+      return;
+    }
+    if (c == MUX_ESC) {
+      _escaped = true;
+      return;
+    }
+    if (_escaped) {
+      c ^= 0x20;
+      _escaped = false;
+    }
+    switch (_state) {
+    case 0:
+      break;
+    case 1:
+      _ch = c;
+      _state = 2;
+      break;
+    case 2:
+      _left = c;
+      _state = c ? 3 : 4;
+      break;
+    case 3:
+      _lines += _ch == 0 && c == '\n';
+      _state = --_left ? 3 : 4;
+      break;
+    default: // The CRC
+      _state = 0;
+    }
+  }
+};
+
+static std::string request(size_t payload, int seq) {
+  std::string s = "echo ";
+  for (size_t i = 0; i < payload; i++)
+    s += (char)('a' + (seq + i) % 26);
+  return s + "\n";
+}
+
+static unsigned long percentile(std::vector<unsigned long> &v, int pct) {
+  if (v.empty())
+    return 0;
+  size_t i = (v.size() - 1) * pct / 100;
+  std::nth_element(v.begin(), v.begin() + i, v.end());
+  return v[i];
+}
+
+static void measure(const Mode &mode, size_t payload, int requests, int fd) {
+  Driver d(fd, mode);
+  int lost = 0;
+
+  // Latency, one request at a time (the first few warm up)
+  std::vector<unsigned long> us;
+  for (int i = -10; i < requests && lost < MAX_LOST; i++) {
+    unsigned long long start = nowNs();
+    d.send(request(payload, i));
+    if (!d.receive()) {
+      lost++;
+      d.resync();
+    } else if (i >= 0) {
+      us.push_back((unsigned long)((nowNs() - start) / 1000));
+    }
+  }
+  unsigned long hi = us.empty() ? 0 : *std::max_element(us.begin(), us.end());
+  unsigned long p50 = percentile(us, 50);
+  unsigned long p90 = percentile(us, 90);
+  unsigned long p99 = percentile(us, 99);
+  lost = requests - (int)us.size();
+
+  // Throughput, WINDOW requests in flight, up to the first lost reply
+  unsigned long long bytes0 = d.bytes();
+  unsigned long long start = nowNs();
+  unsigned long long last = start;
+  int sent = 0, done = 0;
+  while (done < requests) {
+    for (; sent < requests && sent - done < WINDOW; sent++)
+      d.send(request(payload, sent));
+    if (!d.receive())
+      break;
+    done++;
+    last = nowNs();
+  }
+  double s = (last - start) / 1e9;
+  double cmds = done ? done / s : 0;
+  double bytes = done ? (d.bytes() - bytes0) / s : 0;
+  lost = std::max(lost, requests - done);
+
+  printf("%s,%zu,%d,%d,%lu,%lu,%lu,%lu,%.0f,%.0f\n", mode.name, payload,
+         requests, lost, p50, p90, p99, hi, cmds, bytes);
+  fflush(stdout);
+}
+
+// =============================================================
+// SECTION 3: MAIN
+// =============================================================
+
+// Master fd of a raw pty; the slave's name goes to 'slave'
+static int openPty(std::string &slave) {
+  int fd = posix_openpt(O_RDWR | O_NOCTTY);
+  if (fd < 0 || grantpt(fd) < 0 || unlockpt(fd) < 0)
+    return -1;
+  slave = ptsname(fd);
+  termios t;
+  tcgetattr(fd, &t);
+  cfmakeraw(&t);
+  tcsetattr(fd, TCSANOW, &t);
+  return fd;
+}
+
+int main(int argc, char **argv) {
+  int requests = argc > 1 ? atoi(argv[1]) : 2000;
+  const char *only = argc > 2 ? argv[2] : nullptr;
+  printf("mode,payload,requests,lost,p50_us,p90_us,p99_us,max_us,"
+         "cmds_per_s,bytes_per_s\n");
+
+  for (const Mode &mode : MODES) {
+    if (only && strcmp(only, mode.name) != 0)
+      continue;
+    for (size_t payload : PAYLOADS) {
+      std::string name;
+      int master = openPty(name);
+      if (master < 0) {
+        perror("pty");
+        return 1;
+      }
+      fflush(stdout);
+      pid_t pid = fork();
+      if (pid == 0) {
+        close(master);
+        int fd = open(name.c_str(), O_RDWR | O_NOCTTY);
+        termios t;
+        tcgetattr(fd, &t);
+        cfmakeraw(&t);
+        tcsetattr(fd, TCSANOW, &t);
+        HardwareSerial port(fd, fd);
+        mode.serve(port, fd);
+      }
+      measure(mode, payload, requests, master);
+      kill(pid, SIGKILL);
+      waitpid(pid, nullptr, 0);
+      close(master);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,109 @@
+// Receive overruns with 1, 2 and 4 line slots (Config::LINE_SLOTS) when
+// lines arrive back to back while commands run and the loop does other
+// work. Runs on the virtual clock with a 63-byte receive buffer, like an
+// AVR's, so every run prints the same numbers.
+//
+//   cd extras/bench
+//   g++ -O2 -I../host -I../../SerialConsole slot_bench.cpp ../host/Arduino.cpp
+//   ./a.out
+//
+// loop() is modelled as handleInput() plus "loop us" of other work; each
+// line is "work <seq>", a command that takes "cmd us". Bytes arriving
+// while the buffer is full are dropped, so the lines they belonged to
+// come out garbled or not at all. "lost" counts those bytes, "ran" the
+// lines that ran intact; "overruns" and "rx peak" are what the console's
+// own stats saw.
+#include "SerialConsole.h"
+#include "MockStream.h"
+
+#include <string>
+
+static const int LINES = 32;
+
+static MockStream mock;
+static bool ran[LINES];
+static unsigned long cmdUs;
+
+void work(int seq) {
+  if (seq >= 0 && seq < LINES)
+    ran[seq] = true;
+  delayMicroseconds(cmdUs);
+}
+
+template <uint8_t N> struct SlotConfig : DefaultConsoleConfig {
+  static const uint8_t LINE_SLOTS = N;
+  static const bool ECHO_LINES = false;
+  static const ErrorVerbosity ERROR_TEXT = ERRORS_NONE;
+  static const bool STATS = true;
+};
+
+// =============================================================
+// SECTION 1: SCHEDULES
+// =============================================================
+
+struct Schedule {
+  const char *name;
+  unsigned long baud;
+  int burst;            // Lines sent back to back, then BURST_GAP_US
+  unsigned long cmdUs;  // Time each command takes
+  unsigned long loopUs; // Other work between handleInput() calls
+};
+
+static const unsigned long BURST_GAP_US = 50000;
+
+static const Schedule schedules[] = {
+    {"115200, idle loop", 115200, 16, 100, 100},
+    {"115200, 2 ms loop", 115200, 8, 100, 2000},
+    {"115200, 2 ms loop, 16", 115200, 16, 100, 2000},
+    {"115200, 2 ms commands", 115200, 16, 2000, 100},
+    {"115200, 1 ms each", 115200, 16, 1000, 1000},
+    {"250000, 1 ms loop", 250000, 16, 100, 1000},
+    {"1M, 500 us loop", 1000000, 8, 50, 500},
+    {"1M, 500 us loop, 16", 1000000, 16, 50, 500},
+    {"1M, 500 us commands", 1000000, 16, 500, 50},
+};
+
+// =============================================================
+// SECTION 2: MAIN
+// =============================================================
+
+template <uint8_t N> static void run(const Schedule &s) {
+  auto console = createConsoleStream<SlotConfig<N>>(mock, "work", work, "seq");
+  useVirtualClock(true);
+  mock = MockStream();
+  mock.setRxBuffer(63);
+  mock.setBaud(s.baud);
+  cmdUs = s.cmdUs;
+  for (int i = 0; i < LINES; i++) {
+    ran[i] = false;
+    mock.feed("work " + std::to_string(i) + "\n");
+    if ((i + 1) % s.burst == 0)
+      mock.gap(BURST_GAP_US);
+  }
+
+  while (mock.pending()) {
+    console.handleInput();
+    advanceMicros(s.loopUs);
+  }
+  for (int i = 0; i < N + 1; i++)
+    console.handleInput();
+  mock.takeOutput();
+
+  int done = 0;
+  for (int i = 0; i < LINES; i++)
+    done += ran[i];
+  const ConsoleStats &st = console.stats();
+  printf("%-24s %5u %5d %6lu %8u %7u\n", s.name, N, done, mock.lost(),
+         st.overruns, st.rxPeak);
+}
+
+int main() {
+  printf("%-24s %5s %5s %6s %8s %7s\n", "schedule", "slots", "ran", "lost",
+         "overruns", "rx peak");
+  for (const Schedule &s : schedules) {
+    run<1>(s);
+    run<2>(s);
+    run<4>(s);
+  }
+  return 0;
+}
@@ -0,0 +1,102 @@
+#include "Arduino.h"
+
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+HardwareSerial Serial;
+
+// =============================================================
+// SECTION 1: TIME & PINS
+// =============================================================
+
+static bool virtualClock = false;
+static unsigned long virtualUs = 0;
+
+// Starts at 0 every time it's switched on
+void useVirtualClock(bool on) {
+  if (on)
+    virtualUs = 0;
+  virtualClock = on;
+}
+
+void advanceMicros(unsigned long us) { virtualUs += us; }
+
+unsigned long micros() {
+  if (virtualClock)
+    return virtualUs;
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (unsigned long)(t.tv_sec * 1000000ULL + t.tv_nsec / 1000);
+}
+
+unsigned long millis() { return micros() / 1000; }
+
+void delay(unsigned long ms) { delayMicroseconds(ms * 1000); }
+
+void delayMicroseconds(unsigned int us) {
+  if (virtualClock)
+    advanceMicros(us);
+  else
+    usleep(us);
+}
+
+int digitalRead(uint8_t) { return LOW; }
+
+// =============================================================
+// SECTION 2: SERIAL
+// =============================================================
+
+int HardwareSerial::available() {
+  if (_redirect)
+    return _redirect->available();
+  int n = 0;
+  if (ioctl(_in, FIONREAD, &n) < 0)
+    n = 0;
+  return n + (_peeked >= 0 ? 1 : 0);
+}
+
+int HardwareSerial::read() {
+  if (_redirect)
+    return _redirect->read();
+  if (_peeked >= 0) {
+    int c = _peeked;
+    _peeked = -1;
+    return c;
+  }
+  pollfd p = {_in, POLLIN, 0};
+  uint8_t c;
+  if (poll(&p, 1, 0) <= 0 || ::read(_in, &c, 1) != 1)
+    return -1;
+  return c;
+}
+
+int HardwareSerial::peek() {
+  if (_redirect)
+    return _redirect->peek();
+  if (_peeked < 0)
+    _peeked = read();
+  return _peeked;
+}
+
+size_t HardwareSerial::write(uint8_t c) { return write(&c, 1); }
+
+// Writes to the fd block instead of failing, so report a full UART TX
+// buffer's worth of room, as an idle AVR would
+int HardwareSerial::availableForWrite() {
+  return _redirect ? _redirect->availableForWrite() : 63;
+}
+
+size_t HardwareSerial::write(const uint8_t *buf, size_t len) {
+  if (_redirect)
+    return _redirect->write(buf, len);
+  size_t done = 0;
+  while (done < len) {
+    ssize_t n = ::write(_out, buf + done, len - done);
+    if (n <= 0)
+      break;
+    done += n;
+  }
+  return done;
+}
@@ -0,0 +1,142 @@
+#ifndef ARDUINO_HOST_H
+#define ARDUINO_HOST_H
+
+// Minimal Arduino core for building the library on a PC (Linux/macOS).
+// Only what SerialConsole and its tools use; not a general emulator.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+// =============================================================
+// SECTION 1: FLASH, PINS & TIME
+// =============================================================
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+#define PSTR(s) (s)
+#define PROGMEM
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+#define pgm_read_ptr(p) (*(void *const *)(p))
+#define strlen_P strlen
+#define strcmp_P strcmp
+#define memcpy_P memcpy
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define DEC 10
+#define HEX 16
+
+unsigned long micros();
+unsigned long millis();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+int digitalRead(uint8_t pin);
+inline void pinMode(uint8_t, uint8_t) {}
+
+// Host only: with the virtual clock on, micros() and millis() stand still
+// except for advanceMicros() and delay() calls, so tests are repeatable
+void useVirtualClock(bool on);
+void advanceMicros(unsigned long us);
+
+// =============================================================
+// SECTION 2: PRINT & STREAM
+// =============================================================
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t) = 0;
+  virtual size_t write(const uint8_t *buf, size_t len) {
+    size_t n = 0;
+    while (len--)
+      n += write(*buf++);
+    return n;
+  }
+  size_t write(const char *s) { return s ? write((const uint8_t *)s, strlen(s)) : 0; }
+  size_t write(const char *buf, size_t len) { return write((const uint8_t *)buf, len); }
+  virtual int availableForWrite() { return 0; }
+  virtual void flush() {}
+
+  size_t print(const __FlashStringHelper *s) { return write((const char *)s); }
+  size_t print(const char *s) { return write(s); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char n, int base = DEC) { return print((unsigned long)n, base); }
+  size_t print(int n, int base = DEC) { return print((long)n, base); }
+  size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); }
+  size_t print(long n, int base = DEC) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), base == HEX ? "%lX" : "%ld", n);
+    return write(buf);
+  }
+  size_t print(unsigned long n, int base = DEC) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), base == HEX ? "%lX" : "%lu", n);
+    return write(buf);
+  }
+  size_t print(double d, int digits = 2) {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", digits, d);
+    return write(buf);
+  }
+
+  size_t println() { return write("\r\n"); }
+  template <typename T> size_t println(T v) { return print(v) + println(); }
+  template <typename T> size_t println(T v, int fmt) {
+    return print(v, fmt) + println();
+  }
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+};
+
+// Serial on a pair of file descriptors (stdin/stdout by default), non
+// blocking on the read side like the real UART
+class HardwareSerial : public Stream {
+public:
+  HardwareSerial(int inFd = 0, int outFd = 1)
+      : _in(inFd), _out(outFd), _peeked(-1), _baud(0), _redirect(nullptr) {}
+
+  void begin(unsigned long baud) { _baud = baud; }
+  void end() {}
+  unsigned long baud() const { return _baud; }
+  void setFds(int inFd, int outFd) {
+    _in = inFd;
+    _out = outFd;
+    _peeked = -1;
+  }
+
+  // Route all traffic through another Stream (e.g. a MockStream) instead
+  // of the fds; nullptr switches back
+  void redirect(Stream *s) { _redirect = s; }
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buf, size_t len) override;
+  int availableForWrite() override;
+  using Print::write;
+  operator bool() { return true; }
+
+private:
+  int _in, _out;
+  int _peeked;
+  unsigned long _baud;
+  Stream *_redirect;
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,200 @@
+#ifndef MOCK_STREAM_H
+#define MOCK_STREAM_H
+
+// In-memory Stream for host tools: the tool queues input, the sketch's
+// output collects until the tool takes it. Hand it to a console directly
+// or route Serial through it with Serial.redirect(&mock).
+//
+// Every input byte gets an arrival time on the micros() clock and only
+// shows up in available() once that time has passed. With the virtual
+// clock (useVirtualClock()) this replays a byte schedule exactly:
+//
+//   mock.setBaud(9600);      // ~1042 us per byte from here on
+//   mock.feed("set 1\r\n");  // back to back at the line rate
+//   mock.gap(5000);          // the line stays silent for 5 ms
+//   mock.burst("get\n");     // all at once, like a USB packet
+//
+// attach(Serial) also models the rate of the device's port: while
+// Serial.baud() differs from setBaud(), bytes read as 0xFF both ways,
+// like a UART sampling at the wrong rate.
+//
+// setRxBuffer(63) models the device's receive buffer: a byte arriving
+// while that many wait unread is dropped, as the RX interrupt would.
+// setTxBuffer(63) models the transmit side: availableForWrite() reports
+// what's left while written bytes leave at the setBaud() rate.
+
+#include "Arduino.h"
+
+#include <string>
+#include <vector>
+
+class MockStream : public Stream {
+public:
+  MockStream()
+      : _port(nullptr), _baud(0), _pos(0), _admitted(0), _rxBuffer(0),
+        _lost(0), _txBuffer(0), _byteUs(0), _next(0), _txDone(0) {}
+
+  // --- Schedule ---
+  // Line rate of later feed() calls, 8N1 (10 bits per byte). 0, the
+  // default, delivers bytes as soon as they are fed.
+  void setBaud(unsigned long baud) {
+    _baud = baud;
+    _byteUs = baud ? 1e7 / baud : 0;
+  }
+
+  // The device end of the line; see above
+  void attach(HardwareSerial &port) { _port = &port; }
+
+  // Receive buffer size; 0, the default, never drops a byte
+  void setRxBuffer(size_t bytes) { _rxBuffer = bytes; }
+
+  // Transmit buffer size; 0, the default, always reports TX_ROOM
+  void setTxBuffer(size_t bytes) { _txBuffer = bytes; }
+  static const int TX_ROOM = 1024;
+
+  // Queues bytes back to back after the ones already queued (or from
+  // now, if the line went idle). Returns when the last one arrives.
+  unsigned long feed(const std::string &bytes) {
+    compact();
+    unsigned long at = (unsigned long)start();
+    for (char c : bytes) {
+      _next = start() + _byteUs;
+      at = (unsigned long)_next;
+      queue(c, at);
+    }
+    return at;
+  }
+
+  // Like feed(), but all bytes arrive at the same moment
+  unsigned long burst(const std::string &bytes) {
+    compact();
+    unsigned long at = (unsigned long)start();
+    for (char c : bytes)
+      queue(c, at);
+    return at;
+  }
+
+  // Idle time before the next queued byte
+  void gap(unsigned long us) { _next = start() + us; }
+
+  // Input bytes not read yet, arrived or not
+  size_t pending() const { return _in.size() - _pos; }
+
+  // Arrival time of the next unread byte; only valid while pending()
+  unsigned long nextArrival() const { return _at[_pos]; }
+
+  // Bytes dropped by a full receive buffer so far
+  unsigned long lost() const { return _lost; }
+
+  size_t outputSize() const { return _out.size(); }
+
+  std::string takeOutput() {
+    std::string s;
+    s.swap(_out);
+    return s;
+  }
+
+  // --- Stream ---
+  int available() override {
+    admit();
+    return (int)(_admitted - _pos);
+  }
+
+  int read() override {
+    if (!available())
+      return -1;
+    return noise((uint8_t)_in[_pos++]);
+  }
+
+  int peek() override {
+    if (!available())
+      return -1;
+    return noise((uint8_t)_in[_pos]);
+  }
+
+  // --- Print ---
+  size_t write(uint8_t c) override {
+    send();
+    _out += (char)noise(c);
+    return 1;
+  }
+
+  size_t write(const uint8_t *buf, size_t len) override {
+    for (size_t i = 0; i < len; i++) {
+      send();
+      _out += (char)noise(buf[i]);
+    }
+    return len;
+  }
+
+  int availableForWrite() override {
+    if (!_txBuffer)
+      return TX_ROOM;
+    double backlog = _byteUs ? (_txDone - micros()) / _byteUs : 0;
+    int room = (int)_txBuffer - (backlog > 0 ? (int)(backlog + 0.999) : 0);
+    return room > 0 ? room : 0;
+  }
+
+  using Print::write;
+
+private:
+  HardwareSerial *_port;
+  unsigned long _baud;
+  std::string _in;
+  std::vector<unsigned long> _at; // Arrival time of each byte in _in
+  size_t _pos;
+  size_t _admitted; // Bytes of _in that arrived and weren't dropped
+  size_t _rxBuffer;
+  unsigned long _lost;
+  size_t _txBuffer;
+  double _byteUs;
+  double _next; // When the line is free for the next byte
+  double _txDone; // When the last written byte has left
+  std::string _out;
+
+  double start() const {
+    double now = micros();
+    return _next > now ? _next : now;
+  }
+
+  void queue(char c, unsigned long at) {
+    _in += c;
+    _at.push_back(at);
+  }
+
+  // A byte as the other end sees it; setBaud(0) matches any rate
+  uint8_t noise(uint8_t c) const {
+    return _port && _baud && _port->baud() != _baud ? 0xFF : c;
+  }
+
+  // One more byte on the TX line
+  void send() {
+    double now = micros();
+    _txDone = (_txDone > now ? _txDone : now) + _byteUs;
+  }
+
+  // Takes in what arrived by now. The buffer only empties on reads, so
+  // doing this lazily before each one gives the same drops.
+  void admit() {
+    unsigned long now = micros();
+    while (_admitted < _in.size() && (long)(now - _at[_admitted]) >= 0) {
+      if (_rxBuffer && _admitted - _pos >= _rxBuffer) {
+        _in.erase(_admitted, 1);
+        _at.erase(_at.begin() + _admitted);
+        _lost++;
+      } else {
+        _admitted++;
+      }
+    }
+  }
+
+  // Drops what was read already
+  void compact() {
+    _in.erase(0, _pos);
+    _at.erase(_at.begin(), _at.begin() + _pos);
+    _admitted -= _pos;
+    _pos = 0;
+  }
+};
+
+#endif
@@ -0,0 +1,389 @@
+// Replays session transcripts through a sketch and checks its output and
+// speed. Linked with the sketch under test, which provides setup() and
+// loop() and talks to Serial; see run.sh for the build.
+//
+//   replay [--record] [--timings FILE] [--baseline FILE] [--tolerance PCT]
+//          transcript...
+//
+// Transcript format, one entry per line:
+//   # comment
+//   > text       send text and "\n"
+//   >> text      send text without a terminator
+//   + 5000       advance the clock by 5000 us (for idle timeouts)
+//   @ 1000000    the host's port moves to 1000000 baud; while Serial is
+//                at another rate, bytes read as 0xFF (see MockStream.h)
+//   < text       one line of expected output
+// Text takes C escapes (\r \n \t \\ \xHH). After each entry loop() runs
+// until the input is read and the output stops; the < lines that follow
+// must match what was printed (CRLF is compared as LF).
+// Output of setup() goes before the first entry.
+//
+// Every transcript runs in its own process, starting from setup(), on
+// the virtual clock: micros() only moves on "+" entries and input arrives
+// all at once, so the output doesn't depend on how fast the host is.
+// --record rewrites the < lines with the actual output instead of
+// checking them. --timings writes the processing time of each entry as
+// CSV (file name,line,us); --baseline compares against such a file and
+// fails entries slower than baseline + PCT % (default 50) + 50 us.
+#include "Arduino.h"
+#include "MockStream.h"
+
+#include <map>
+#include <string>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+void setup();
+void loop();
+
+// =============================================================
+// SECTION 1: TRANSCRIPTS
+// =============================================================
+
+struct Step {
+  int line;                       // Line of the entry, 0 for setup()
+  std::vector<std::string> head;  // Entry and the comments before it
+  std::string input;              // Bytes to send
+  unsigned long waitUs;           // For "+" entries
+  unsigned long baud;             // For "@" entries
+  std::vector<std::string> expected;
+};
+
+static std::string unescape(const std::string &s) {
+  std::string out;
+  for (size_t i = 0; i < s.size(); i++) {
+    if (s[i] != '\\' || i + 1 == s.size()) {
+      out += s[i];
+      continue;
+    }
+    char c = s[++i];
+    if (c == 'r')
+      out += '\r';
+    else if (c == 'n')
+      out += '\n';
+    else if (c == 't')
+      out += '\t';
+    else if (c == 'x' && i + 2 < s.size()) {
+      out += (char)strtol(s.substr(i + 1, 2).c_str(), nullptr, 16);
+      i += 2;
+    } else
+      out += c;
+  }
+  return out;
+}
+
+static std::string escape(const std::string &s) {
+  std::string out;
+  for (unsigned char c : s) {
+    char buf[8];
+    if (c == '\\')
+      out += "\\\\";
+    else if (c == '\t')
+      out += "\\t";
+    else if (c == '\r')
+      out += "\\r";
+    else if (c < 0x20 || c >= 0x7F) {
+      snprintf(buf, sizeof(buf), "\\x%02X", c);
+      out += buf;
+    } else
+      out += (char)c;
+  }
+  return out;
+}
+
+static bool startsWith(const std::string &s, const char *prefix) {
+  return s.compare(0, strlen(prefix), prefix) == 0;
+}
+
+// Text after a marker and its separating space
+static std::string argument(const std::string &s, size_t marker) {
+  if (s.size() > marker && s[marker] == ' ')
+    marker++;
+  return s.substr(marker);
+}
+
+// 'tail' gets the comments after the last entry
+static bool parse(const char *path, std::vector<Step> &steps,
+                  std::vector<std::string> &tail) {
+  FILE *f = fopen(path, "r");
+  if (!f) {
+    perror(path);
+    return false;
+  }
+  steps.assign(1, Step());
+  steps[0].line = 0;
+  steps[0].waitUs = 0;
+  steps[0].baud = 0;
+  std::vector<std::string> comments;
+
+  char buf[4096];
+  for (int n = 1; fgets(buf, sizeof(buf), f); n++) {
+    std::string s(buf);
+    while (!s.empty() && (s.back() == '\n' || s.back() == '\r'))
+      s.pop_back();
+
+    if (startsWith(s, "<")) {
+      steps.back().expected.push_back(unescape(argument(s, 1)));
+      continue;
+    }
+    if (s.empty() || startsWith(s, "#")) {
+      // Comments above the setup() output stay at the top when recording
+      if (steps.size() == 1 && steps[0].expected.empty())
+        steps[0].head.push_back(s);
+      else
+        comments.push_back(s);
+      continue;
+    }
+
+    Step step;
+    step.line = n;
+    step.waitUs = 0;
+    step.baud = 0;
+    if (startsWith(s, ">>"))
+      step.input = unescape(argument(s, 2));
+    else if (startsWith(s, ">"))
+      step.input = unescape(argument(s, 1)) + "\n";
+    else if (startsWith(s, "+"))
+      step.waitUs = strtoul(argument(s, 1).c_str(), nullptr, 10);
+    else if (startsWith(s, "@"))
+      step.baud = strtoul(argument(s, 1).c_str(), nullptr, 10);
+    else {
+      fprintf(stderr, "%s:%d: unknown entry '%s'\n", path, n, s.c_str());
+      fclose(f);
+      return false;
+    }
+    step.head.swap(comments);
+    step.head.push_back(s);
+    steps.push_back(step);
+  }
+  tail.swap(comments);
+  fclose(f);
+  return true;
+}
+
+// =============================================================
+// SECTION 2: RUNNING THE SKETCH
+// =============================================================
+
+static const int QUIET_LOOPS = 3;
+static const long MAX_LOOPS = 1000000;
+
+static MockStream mock;
+
+// Wall clock, independent of what the sketch sees through micros()
+static unsigned long nowUs() {
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (unsigned long)(t.tv_sec * 1000000ULL + t.tv_nsec / 1000);
+}
+
+// Calls loop() until the input is read and a few calls in a row change
+// nothing. Returns the time up to the last call that did something.
+static unsigned long runUntilQuiet() {
+  unsigned long start = nowUs();
+  unsigned long last = start;
+  int quiet = 0;
+  for (long n = 0; quiet < QUIET_LOOPS && n < MAX_LOOPS; n++) {
+    size_t in = mock.pending();
+    size_t out = mock.outputSize();
+    loop();
+    if (mock.pending() != in || mock.outputSize() != out) {
+      quiet = 0;
+      last = nowUs();
+    } else {
+      quiet++;
+    }
+  }
+  return last - start;
+}
+
+static std::vector<std::string> outputLines(std::string text) {
+  std::vector<std::string> lines;
+  size_t start = 0;
+  for (size_t i = 0; i < text.size(); i++) {
+    if (text[i] != '\n')
+      continue;
+    size_t end = i > start && text[i - 1] == '\r' ? i - 1 : i;
+    lines.push_back(text.substr(start, end - start));
+    start = i + 1;
+  }
+  if (start < text.size())
+    lines.push_back(text.substr(start));
+  return lines;
+}
+
+// =============================================================
+// SECTION 3: CHECKING & RECORDING
+// =============================================================
+
+struct Options {
+  bool record;
+  const char *timings;
+  const char *baseline;
+  double tolerance;
+};
+
+static const unsigned long SLACK_US = 50;
+
+// file name:line -> us
+static std::map<std::string, unsigned long> loadBaseline(const char *path) {
+  std::map<std::string, unsigned long> base;
+  FILE *f = fopen(path, "r");
+  if (!f) {
+    perror(path);
+    return base;
+  }
+  char name[1024];
+  int line;
+  unsigned long us;
+  while (fscanf(f, "%1023[^,],%d,%lu\n", name, &line, &us) == 3)
+    base[std::string(name) + ":" + std::to_string(line)] = us;
+  fclose(f);
+  return base;
+}
+
+static void printDiff(const std::vector<std::string> &want,
+                      const std::vector<std::string> &got) {
+  for (const std::string &s : want)
+    printf("  - %s\n", escape(s).c_str());
+  for (const std::string &s : got)
+    printf("  + %s\n", escape(s).c_str());
+}
+
+static bool record(const char *path, const std::vector<Step> &steps,
+                   const std::vector<std::vector<std::string>> &outputs,
+                   const std::vector<std::string> &tail) {
+  FILE *f = fopen(path, "w");
+  if (!f) {
+    perror(path);
+    return false;
+  }
+  for (size_t i = 0; i < steps.size(); i++) {
+    for (const std::string &s : steps[i].head)
+      fprintf(f, "%s\n", s.c_str());
+    for (const std::string &s : outputs[i])
+      fprintf(f, "< %s\n", escape(s).c_str());
+  }
+  for (const std::string &s : tail)
+    fprintf(f, "%s\n", s.c_str());
+  fclose(f);
+  return true;
+}
+
+// Timings are keyed by file name, so a baseline works from any checkout
+static std::string baseName(const char *path) {
+  const char *slash = strrchr(path, '/');
+  return slash ? slash + 1 : path;
+}
+
+// Runs in a fresh child process; returns its exit status
+static int replay(const char *path, const Options &opt, FILE *timings) {
+  std::vector<Step> steps;
+  std::vector<std::string> tail;
+  if (!parse(path, steps, tail))
+    return 2;
+  std::map<std::string, unsigned long> base;
+  if (opt.baseline)
+    base = loadBaseline(opt.baseline);
+
+  useVirtualClock(true);
+  Serial.redirect(&mock);
+  mock.attach(Serial);
+  setup();
+
+  int failures = 0;
+  std::vector<std::vector<std::string>> outputs;
+  for (const Step &step : steps) {
+    unsigned long us = 0;
+    if (step.line > 0) {
+      advanceMicros(step.waitUs);
+      if (step.baud)
+        mock.setBaud(step.baud);
+      mock.burst(step.input);
+      us = runUntilQuiet();
+    }
+    outputs.push_back(outputLines(mock.takeOutput()));
+    const std::vector<std::string> &got = outputs.back();
+
+    if (!opt.record && got != step.expected) {
+      printf("%s:%d: output differs\n", path, step.line);
+      printDiff(step.expected, got);
+      failures++;
+    }
+    if (step.line == 0)
+      continue;
+    std::string key = baseName(path);
+    if (timings)
+      fprintf(timings, "%s,%d,%lu\n", key.c_str(), step.line, us);
+    auto b = base.find(key + ":" + std::to_string(step.line));
+    if (b != base.end() &&
+        us > b->second * (1 + opt.tolerance / 100) + SLACK_US) {
+      printf("%s:%d: %lu us, baseline %lu us\n", path, step.line, us,
+             b->second);
+      failures++;
+    }
+  }
+  if (timings)
+    fflush(timings);
+
+  if (opt.record)
+    return record(path, steps, outputs, tail) ? 0 : 2;
+  return failures ? 1 : 0;
+}
+
+// =============================================================
+// SECTION 4: MAIN
+// =============================================================
+
+int main(int argc, char **argv) {
+  Options opt = {false, nullptr, nullptr, 50};
+  int i = 1;
+  for (; i < argc && startsWith(argv[i], "--"); i++) {
+    std::string a = argv[i];
+    if (a == "--record")
+      opt.record = true;
+    else if (a == "--timings" && i + 1 < argc)
+      opt.timings = argv[++i];
+    else if (a == "--baseline" && i + 1 < argc)
+      opt.baseline = argv[++i];
+    else if (a == "--tolerance" && i + 1 < argc)
+      opt.tolerance = atof(argv[++i]);
+    else {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return 2;
+    }
+  }
+  if (i == argc) {
+    fprintf(stderr, "usage: %s [--record] [--timings FILE] "
+                    "[--baseline FILE] [--tolerance PCT] transcript...\n",
+            argv[0]);
+    return 2;
+  }
+
+  FILE *timings = nullptr;
+  if (opt.timings && !(timings = fopen(opt.timings, "w"))) {
+    perror(opt.timings);
+    return 2;
+  }
+
+  int failed = 0;
+  for (; i < argc; i++) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+      int status = replay(argv[i], opt, timings);
+      fflush(stdout);
+      _exit(status);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    printf("%s %s\n", ok ? "ok  " : "FAIL", argv[i]);
+    failed += !ok;
+  }
+  if (timings)
+    fclose(timings);
+  return failed ? 1 : 0;
+}
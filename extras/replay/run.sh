@@ -0,0 +1,44 @@
+#!/bin/sh
+# Builds the replay tool with a sketch (default: sketch.cpp next to this
+# script) and replays the golden transcripts through it.
+#
+#   extras/replay/run.sh [replay options]
+#   SKETCH=my.cpp extras/replay/run.sh --record my_transcripts/*.txt
+#
+# Without transcript arguments, golden/*.txt are replayed, then each
+# suites/<name>/*.txt through suites/<name>/sketch.cpp (skipped when
+# SKETCH is set).
+set -e
+
+CXX=${CXX:-g++}
+HERE=$(cd "$(dirname "$0")" && pwd)
+ROOT=$(cd "$HERE/../.." && pwd)
+SUITES=${SKETCH:+no}
+SKETCH=${SKETCH:-$HERE/sketch.cpp}
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+build() {
+  $CXX -std=gnu++11 -O2 -I"$ROOT/extras/host" -I"$ROOT/SerialConsole" \
+    "$1" "$HERE/replay.cpp" "$ROOT/extras/host/Arduino.cpp" -o "$2"
+}
+
+for arg; do
+  case $arg in
+  *.txt)
+    build "$SKETCH" "$TMP/replay"
+    exec "$TMP/replay" "$@"
+    ;;
+  esac
+done
+
+build "$SKETCH" "$TMP/replay"
+status=0
+"$TMP/replay" "$@" "$HERE"/golden/*.txt || status=1
+[ -n "$SUITES" ] && exit $status
+for suite in "$HERE"/suites/*/; do
+  [ -f "$suite/sketch.cpp" ] || continue
+  build "$suite/sketch.cpp" "$TMP/suite"
+  "$TMP/suite" "$@" "$suite"*.txt || status=1
+done
+exit $status
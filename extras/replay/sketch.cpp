@@ -0,0 +1,79 @@
+// Sketch the transcripts in golden/ were recorded with. Output must not
+// depend on timing, so no STATS (it reports the slowest dispatch); bench,
+// ping and absorb times are fixed on the virtual clock.
+#include "SerialConsole.h"
+
+struct ReplayConfig : DefaultConsoleConfig {
+  static const bool FLOW_CONTROL = true;
+  static const bool LINE_INTEGRITY = true;
+  static const bool IDLE_TIMEOUT = true;
+  static const bool BENCH = true;
+  static const bool PING = true;
+  static const bool LINK_TEST = true;
+  static const bool BAUD_SWITCH = true;
+  static const bool OUT_OF_BAND = true;
+  static const bool PROMPTS = true;
+  static const bool JSON_LINES = true;
+};
+
+void setSpeed(int rpm, float ramp);
+void setName(const char *name);
+void reset();
+void enable(bool on);
+void erase();
+void raw();
+
+auto console = createConsole<ReplayConfig>(
+    "speed", setSpeed, "rpm, ramp",
+    "name", setName, "str",
+    "reset", reset, nullptr,
+    "enable", enable, "bool",
+    "erase", erase, nullptr,
+    "raw", raw, nullptr);
+
+void setSpeed(int rpm, float ramp) {
+  console.printf(CONSOLE_FMT("speed %d rpm, ramp %.2f\n"), rpm, ramp);
+}
+
+void setName(const char *name) {
+  console.out().print(F("name "));
+  console.out().println(name);
+}
+
+void reset() { console.out().println(F("reset")); }
+
+void enable(bool on) { console.out().println(on ? F("on") : F("off")); }
+
+// Two prompts in a row: y/n, then the name typed back
+void confirmErase(const char *reply) {
+  if (strcmp(reply, "erase all") == 0)
+    console.out().println(F("erased"));
+  else
+    console.out().println(F("kept"));
+}
+
+void askErase(const char *reply) {
+  if (strcmp(reply, "y") == 0)
+    console.prompt(F("type 'erase all' to confirm"), confirmErase);
+  else
+    console.out().println(F("kept"));
+}
+
+void erase() { console.prompt(F("erase flash? y/n"), askErase); }
+
+// Bypasses the console's output queue
+void raw() { Serial.println(F("raw")); }
+
+void stop() { console.out().println(F("break")); }
+
+void setup() {
+  Serial.begin(115200);
+  console.setTerminators(";\r\n");
+  console.setIdleTimeout(20000);
+  console.setBaudHook([](unsigned long baud) { Serial.begin(baud); }, 115200);
+  console.setBreak('\x03', stop);
+  console.setXonXoff(true);
+  Serial.println(F("ready"));
+}
+
+void loop() { console.handleInput(); }
@@ -0,0 +1,38 @@
+// Without FLOW_CONTROL, on a stream that doesn't implement
+// availableForWrite(), like SoftwareSerial: a flood still makes progress.
+#include "SerialConsole.h"
+
+class PlainStream : public Stream {
+public:
+  explicit PlainStream(Stream &s) : _s(s) {}
+
+  int available() override { return _s.available(); }
+  int read() override { return _s.read(); }
+  int peek() override { return _s.peek(); }
+  size_t write(uint8_t c) override { return _s.write(c); }
+  using Print::write;
+
+private:
+  Stream &_s;
+};
+
+struct DirectConfig : DefaultConsoleConfig {
+  static const bool FLOW_CONTROL = false;
+  static const bool LINK_TEST = true;
+};
+
+PlainStream port(Serial);
+
+void reset();
+
+auto console =
+    createConsoleStream<DirectConfig>(port, "reset", reset, nullptr);
+
+void reset() { console.out().println(F("reset")); }
+
+void setup() {
+  Serial.begin(9600);
+  Serial.println(F("ready"));
+}
+
+void loop() { console.handleInput(); }
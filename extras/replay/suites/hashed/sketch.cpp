@@ -0,0 +1,29 @@
+// HashedLookup with names whose one-byte hashes collide, and
+// WhitespaceTokenizer. "set" and "abc" both hash to 98, "get" and "arg"
+// to 86 (h = h * 31 + c).
+#include "SerialConsole.h"
+
+struct HashedConfig : DefaultConsoleConfig {
+  typedef HashedLookup Lookup;
+  typedef WhitespaceTokenizer Tokenizer;
+};
+
+void set(int v) { Serial.print(F("set ")); Serial.println(v); }
+void abc(int v) { Serial.print(F("abc ")); Serial.println(v); }
+void get() { Serial.println(F("get")); }
+void arg(const char *s) { Serial.print(F("arg ")); Serial.println(s); }
+void add(int a, int b) { Serial.println(a + b); }
+
+auto console = createConsole<HashedConfig>(
+    "set", set, "<v>",
+    "abc", abc, "<v>",
+    "get", get, nullptr,
+    "arg", arg, "<text>",
+    "add", add, "<a> <b>");
+
+void setup() {
+  Serial.begin(9600);
+  Serial.println(F("ready"));
+}
+
+void loop() { console.handleInput(); }
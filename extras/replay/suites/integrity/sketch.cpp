@@ -0,0 +1,23 @@
+// Line checksums: NMEA from the start, CRC-16 after "crc16"
+#include "SerialConsole.h"
+
+struct IntegrityConfig : DefaultConsoleConfig {
+  static const bool LINE_INTEGRITY = true;
+};
+
+void set(int v) { Serial.println(v); }
+void crc16();
+
+auto console = createConsole<IntegrityConfig>(
+    "set", set, "value",
+    "crc16", crc16, nullptr);
+
+void crc16() { console.setLineIntegrity(INTEGRITY_CRC16); }
+
+void setup() {
+  Serial.begin(9600);
+  console.setLineIntegrity(INTEGRITY_NMEA);
+  Serial.println(F("ready"));
+}
+
+void loop() { console.handleInput(); }
@@ -0,0 +1,25 @@
+// The console on ConsoleMux channel 0. Channel 1 echoes its payload back
+// so stuffing shows both ways; "bad" reports dropped frames.
+#include "SerialConsole.h"
+#include "ConsoleMux.h"
+
+ConsoleMux<2> mux(Serial);
+
+void bad();
+
+auto console = createConsoleStream(mux.channel(0), "bad", bad, nullptr);
+
+void bad() { console.out().println(mux.badFrames()); }
+
+void setup() {
+  Serial.begin(9600);
+  mux.channel(0).setLineFlush(true);
+}
+
+void loop() {
+  mux.poll();
+  console.handleInput();
+  MuxChannel &echo = mux.channel(1);
+  while (echo.available())
+    echo.write(echo.read());
+}
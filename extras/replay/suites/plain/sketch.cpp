@@ -0,0 +1,37 @@
+// The console on a stream that doesn't implement availableForWrite(),
+// like SoftwareSerial: Print's default reports 0 whatever the room.
+#include "SerialConsole.h"
+
+class PlainStream : public Stream {
+public:
+  explicit PlainStream(Stream &s) : _s(s) {}
+
+  int available() override { return _s.available(); }
+  int read() override { return _s.read(); }
+  int peek() override { return _s.peek(); }
+  size_t write(uint8_t c) override { return _s.write(c); }
+  using Print::write;
+
+private:
+  Stream &_s;
+};
+
+struct PlainConfig : DefaultConsoleConfig {
+  static const bool FLOW_CONTROL = true;
+};
+
+PlainStream port(Serial);
+
+void reset();
+
+auto console =
+    createConsoleStream<PlainConfig>(port, "reset", reset, nullptr);
+
+void reset() { console.out().println(F("reset")); }
+
+void setup() {
+  Serial.begin(9600);
+  Serial.println(F("ready"));
+}
+
+void loop() { console.handleInput(); }
@@ -0,0 +1,24 @@
+// createTypedConsole: lambdas and functions of several signatures
+#include "SerialConsole.h"
+
+int speed;
+
+void ramp(int to, float seconds) {
+  Serial.print(to);
+  Serial.print(' ');
+  Serial.println(seconds, 2);
+}
+
+auto console = createTypedConsole(
+    "set", [](int v) { speed = v; }, "<speed>",
+    "get", []() { Serial.println(speed); }, nullptr,
+    "ramp", ramp, "<to> <seconds>",
+    "name", [](const char *s) { Serial.println(s); }, "<text>",
+    "led", [](bool on) { Serial.println(on ? "on" : "off"); }, "true|false");
+
+void setup() {
+  Serial.begin(9600);
+  Serial.println(F("ready"));
+}
+
+void loop() { console.handleInput(); }
@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+"""Compile time and size of consoles with many commands.
+
+Generates a sketch with N commands (cycling through a handful of parameter
+lists, the way real command sets repeat them), compiles it on the host
+like size_matrix.sh does and prints one CSV row per N and factory:
+
+    commands,factory,compile_s,text,data,bss
+
+A build that fails (e.g. a template depth limit) gets "FAIL" columns.
+
+    python3 extras/size/compile_bench.py [--cxx g++] [--counts 10,50,500]
+"""
+import argparse
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.dirname(os.path.dirname(HERE))
+
+SIGNATURES = [
+    ("", ""),
+    ("int a", "a"),
+    ("int a, int b", "a + b"),
+    ("float v", "(int)v"),
+    ("const char *s", "(int)strlen(s)"),
+    ("bool on", "on"),
+    ("long a, float b, int c", "(int)(a + b + c)"),
+]
+
+FLAGS = ["-std=gnu++11", "-Os", "-ffunction-sections", "-fdata-sections",
+         "-fno-exceptions", "-fno-rtti", "-fno-asynchronous-unwind-tables",
+         "-I" + os.path.join(ROOT, "extras", "host"),
+         "-I" + os.path.join(ROOT, "SerialConsole")]
+
+
+def sketch(n, factory):
+    out = ['#include "SerialConsole.h"', "volatile int sink;"]
+    for i in range(n):
+        params, expr = SIGNATURES[i % len(SIGNATURES)]
+        value = expr or "0"
+        out.append("void cmd%d(%s) { sink = %s + %d; }" % (i, params, value, i))
+    out.append("auto console = %s(" % factory)
+    out.append(",\n".join('  "cmd%d", cmd%d, "usage %d"' % (i, i, i)
+                          for i in range(n)))
+    out.append(");")
+    out.append("void setup() { Serial.begin(115200); }")
+    out.append("void loop() { console.handleInput(); }")
+    return "\n".join(out) + "\n"
+
+
+def measure(cxx, n, factory, tmp):
+    src = os.path.join(tmp, "bench.cpp")
+    obj = os.path.join(tmp, "bench.o")
+    linked = os.path.join(tmp, "linked.o")
+    with open(src, "w") as f:
+        f.write(sketch(n, factory))
+
+    start = time.monotonic()
+    build = subprocess.run([cxx] + FLAGS + ["-c", src, "-o", obj],
+                           stdout=subprocess.DEVNULL, stderr=subprocess.PIPE)
+    elapsed = time.monotonic() - start
+    if build.returncode != 0:
+        sys.stderr.write(build.stderr.decode(errors="replace")[-2000:])
+        return ["FAIL"] * 4
+
+    # Keep only what loop()/setup() reach, as the Arduino link would
+    subprocess.run([cxx, "-r", "-Wl,--gc-sections", "-Wl,-e,_Z4loopv",
+                    "-Wl,-u,_Z5setupv", "-nostdlib", obj, "-o", linked],
+                   check=True)
+    size = subprocess.run(["size", linked], check=True,
+                          stdout=subprocess.PIPE).stdout.decode()
+    text, data, bss = size.splitlines()[1].split()[:3]
+    return ["%.2f" % elapsed, text, data, bss]
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("--cxx", default=os.environ.get("CXX", "g++"))
+    ap.add_argument("--counts", default="10,50,100,150,250,500")
+    ap.add_argument("--factories", default="createConsole,createTypedConsole")
+    args = ap.parse_args()
+
+    print("commands,factory,compile_s,text,data,bss")
+    with tempfile.TemporaryDirectory() as tmp:
+        for n in [int(c) for c in args.counts.split(",")]:
+            for factory in args.factories.split(","):
+                row = [str(n), factory] + measure(args.cxx, n, factory, tmp)
+                print(",".join(row))
+                sys.stdout.flush()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,46 @@
+#!/bin/sh
+# Host-built object sizes of extras/size/sketch.cpp for the main policy
+# combinations. Absolute numbers are x86-64, compare them relative to
+# each other (and to the baseline without a console).
+#
+#   extras/size/size_matrix.sh [compiler]
+set -e
+
+CXX=${1:-${CXX:-g++}}
+HERE=$(cd "$(dirname "$0")" && pwd)
+ROOT=$(cd "$HERE/../.." && pwd)
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+FLAGS="-std=gnu++11 -Os -ffunction-sections -fdata-sections -fno-exceptions \
+  -fno-rtti -fno-asynchronous-unwind-tables \
+  -I$ROOT/extras/host -I$ROOT/SerialConsole"
+
+# Sum of text+data+bss of an object, after dropping unreferenced sections
+# the way the Arduino link (--gc-sections) would
+measure() {
+  $CXX $FLAGS "$@" -c "$HERE/sketch.cpp" -o "$TMP/sketch.o"
+  $CXX -r -Wl,--gc-sections -Wl,-e,_Z4loopv -Wl,-u,_Z5setupv -nostdlib \
+    "$TMP/sketch.o" -o "$TMP/linked.o"
+  size "$TMP/linked.o" | awk 'NR == 2 { print $1, $2, $3 }'
+}
+
+set -- $(measure -DNO_CONSOLE)
+base=$(($1 + $2 + $3))
+
+printf '%-14s %7s %6s %6s %8s\n' config text data bss "+total"
+printf '%-14s %7s %6s %6s %8s\n' "(no console)" "$1" "$2" "$3" 0
+for cfg in DefaultConsoleConfig FlowConfig LineConfig TerseConfig HashedConfig \
+  StatsConfig BenchConfig PingConfig LinkTestConfig BaudConfig \
+  BreakConfig PromptConfig SlotsConfig JsonConfig TinyConfig; do
+  set -- $(measure -DSIZE_CONFIG=$cfg)
+  printf '%-14s %7s %6s %6s %8s\n' "${cfg%Config}" "$1" "$2" "$3" \
+    $(($1 + $2 + $3 - base))
+done
+set -- $(measure -DSIZE_CONFIG=DefaultConsoleConfig \
+  -DSIZE_FACTORY=createTypedConsole)
+printf '%-14s %7s %6s %6s %8s\n' "(typed)" "$1" "$2" "$3" \
+  $(($1 + $2 + $3 - base))
+set -- $(measure -DSIZE_CONFIG=DefaultConsoleConfig -DSERIAL_CONSOLE_DISABLED)
+printf '%-14s %7s %6s %6s %8s\n' "(disabled)" "$1" "$2" "$3" \
+  $(($1 + $2 + $3 - base))
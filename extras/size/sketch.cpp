@@ -0,0 +1,104 @@
+// Reference sketch for size_matrix.sh. SIZE_CONFIG selects the policy,
+// SIZE_FACTORY the command table; NO_CONSOLE leaves the console out,
+// giving the baseline.
+#include "SerialConsole.h"
+
+#ifndef SIZE_FACTORY
+#define SIZE_FACTORY createConsole
+#endif
+
+void setSpeed(int rpm, float ramp) {
+  Serial.print(rpm);
+  Serial.println(ramp);
+}
+void setName(const char *name) { Serial.println(name); }
+void reset() { Serial.println(F("reset")); }
+void enable(bool on) { Serial.println(on); }
+
+struct FlowConfig : DefaultConsoleConfig {
+  static const bool FLOW_CONTROL = true;
+};
+
+struct LineConfig : DefaultConsoleConfig {
+  static const bool LINE_INTEGRITY = true;
+  static const bool IDLE_TIMEOUT = true;
+};
+
+struct TerseConfig : DefaultConsoleConfig {
+  static const bool ECHO_LINES = false;
+  static const ErrorVerbosity ERROR_TEXT = ERRORS_TERSE;
+};
+
+struct HashedConfig : DefaultConsoleConfig {
+  typedef HashedLookup Lookup;
+};
+
+struct StatsConfig : DefaultConsoleConfig {
+  static const bool STATS = true;
+};
+
+struct BenchConfig : DefaultConsoleConfig {
+  static const bool BENCH = true;
+};
+
+struct PingConfig : DefaultConsoleConfig {
+  static const bool PING = true;
+};
+
+struct LinkTestConfig : DefaultConsoleConfig {
+  static const bool LINK_TEST = true;
+};
+
+struct BaudConfig : DefaultConsoleConfig {
+  static const bool BAUD_SWITCH = true;
+};
+
+struct BreakConfig : DefaultConsoleConfig {
+  static const bool OUT_OF_BAND = true;
+};
+
+struct PromptConfig : DefaultConsoleConfig {
+  static const bool PROMPTS = true;
+};
+
+struct SlotsConfig : DefaultConsoleConfig {
+  static const uint8_t LINE_SLOTS = 2;
+};
+
+struct JsonConfig : DefaultConsoleConfig {
+  static const bool JSON_LINES = true;
+};
+
+struct TinyConfig : DefaultConsoleConfig {
+  static const size_t INPUT_BUF_SIZE = 32;
+  static const size_t ARG_STORE_SIZE = 16;
+  static const bool ECHO_LINES = false;
+  static const bool HELP_COMMAND = false;
+  static const ErrorVerbosity ERROR_TEXT = ERRORS_NONE;
+};
+
+#ifndef NO_CONSOLE
+auto console = SIZE_FACTORY<SIZE_CONFIG>(
+    "speed", setSpeed, "rpm, ramp",
+    "name", setName, "str",
+    "reset", reset, nullptr,
+    "enable", enable, "bool");
+#endif
+
+// Calls the commands directly too, so their bodies count in every build
+// including the baseline
+volatile bool direct = false;
+
+void setup() { Serial.begin(115200); }
+
+void loop() {
+  if (direct) {
+    setSpeed(1, 2);
+    setName("x");
+    reset();
+    enable(true);
+  }
+#ifndef NO_CONSOLE
+  console.handleInput();
+#endif
+}
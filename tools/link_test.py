@@ -0,0 +1,183 @@
+#!/usr/bin/env python3
+"""Link throughput self-test with the console's "flood" and "absorb"
+built-ins (Config::LINK_TEST).
+
+Both directions carry the same pseudo-random pattern (xorshift16 seeded
+with the pattern number), so every byte is checked:
+
+    flood   device -> host: the host sends "flood <bytes> <pattern>" and
+            checks what comes back
+    absorb  host -> device: the host sends "absorb <bytes> <pattern>" and
+            the bytes right after it; the device checks them and replies
+            with its count, errors and time
+
+Rates are taken on the receiving side: the host clock for flood, the
+device's micros() for absorb. Bytes that never arrived count as lost,
+wrong ones as errors; a lost byte in the middle turns the rest into
+errors, so errors close to the byte count mean a dropped byte.
+
+--switch RATE first moves the link with the "baud" built-in
+(Config::BAUD_SWITCH) and tests at the new rate.
+
+    python3 tools/link_test.py /dev/ttyUSB0 -b 115200 --bytes 100000
+    python3 tools/link_test.py /dev/ttyUSB0 --switch 1000000
+"""
+import argparse
+import json
+import re
+import sys
+import time
+
+SILENCE = 1.0  # Seconds without data that end a direction
+
+
+def pattern(seed, n):
+    """The n bytes the console sends or expects for this pattern."""
+    x = seed & 0xFFFF
+    out = bytearray(n)
+    for i in range(n):
+        x ^= (x << 7) & 0xFFFF
+        x ^= x >> 9
+        x ^= (x << 8) & 0xFFFF
+        out[i] = x & 0xFF
+    return bytes(out)
+
+
+def read_some(port):
+    return port.read(port.in_waiting or 1)
+
+
+def flood(port, n, seed):
+    """(received, errors, bytes/s) of a device -> host flood."""
+    expected = pattern(seed, n)
+    head = expected[:8]
+    port.write(b"flood %d %d\n" % (n, seed))
+
+    # Skip the echo and anything else before the pattern
+    data, start = b"", None
+    last = time.monotonic()
+    while start is None and time.monotonic() - last < SILENCE:
+        chunk = read_some(port)
+        if chunk:
+            last = time.monotonic()
+            data += chunk
+            at = data.find(head if n >= len(head) else expected)
+            if at >= 0:
+                data, start = data[at:], last
+    if start is None:
+        return 0, 0, 0.0
+
+    # The rate excludes the first chunk, which arrived at 'start'
+    first, end = len(data), start
+    while len(data) < n and time.monotonic() - last < SILENCE:
+        chunk = read_some(port)
+        if chunk:
+            last = end = time.monotonic()
+            data += chunk
+    data = data[:n]
+    errors = sum(a != b for a, b in zip(data, expected))
+    rate = (len(data) - first) / (end - start) if end > start else 0.0
+    return len(data), errors, rate
+
+
+def parse_absorb(line):
+    """(received, errors, us) of an absorb reply, None for other lines."""
+    text = line.decode(errors="replace").strip()
+    m = re.match(r"absorb (\d+) of \d+ bytes in (\d+) us, (\d+) errors", text)
+    if m:
+        return int(m.group(1)), int(m.group(3)), int(m.group(2))
+    if text.startswith("{"):
+        try:
+            obj = json.loads(text)
+        except ValueError:
+            return None
+        if obj.get("cmd") == "absorb" and obj.get("ok"):
+            return obj["received"], obj["errors"], obj["us"]
+    return None
+
+
+def absorb(port, n, seed):
+    """(received, errors, bytes/s) of a host -> device absorb."""
+    port.write(b"absorb %d %d\n" % (n, seed) + pattern(seed, n))
+    deadline = time.monotonic() + SILENCE + 1
+    while time.monotonic() < deadline:
+        reply = parse_absorb(port.readline())
+        if reply:
+            received, errors, us = reply
+            rate = (received - 1) * 1e6 / us if us else 0.0
+            return received, errors, rate
+    return 0, 0, 0.0
+
+
+def baud_reply(port, rate, timeout):
+    """State of the next "baud <rate> <state>" reply, None if none came."""
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        text = port.readline().decode(errors="replace").strip()
+        m = re.match(r"baud (\d+) (\w+)$", text)
+        if m and int(m.group(1)) == rate:
+            return m.group(2)
+        if text.startswith("{"):
+            try:
+                obj = json.loads(text)
+            except ValueError:
+                continue
+            if obj.get("cmd") == "baud" and obj.get("baud") == rate:
+                return obj.get("state")
+    return None
+
+
+def switch_baud(port, rate):
+    """Moves both ends to rate; False if the device stays where it is."""
+    port.write(b"baud %d\n" % rate)
+    if baud_reply(port, rate, 1.0) != "pending":
+        return False
+    port.baudrate = rate
+    port.reset_input_buffer()
+    # The newline ends whatever noise the change left in the device's line
+    port.write(b"\nbaud %d\n" % rate)
+    return baud_reply(port, rate, 1.0) == "ok"
+
+
+def report(name, n, result, out):
+    received, errors, rate = result
+    out.write("%-7s %d bytes: %d received, %d errors, %d lost, %.0f bytes/s\n"
+              % (name, n, received, errors, n - received, rate))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("port")
+    ap.add_argument("-b", "--baud", type=int, default=115200)
+    ap.add_argument("--bytes", type=int, default=10000)
+    ap.add_argument("--pattern", type=int, default=1,
+                    help="pattern number, 1-65535")
+    ap.add_argument("--only", choices=["flood", "absorb"],
+                    help="test one direction")
+    ap.add_argument("--switch", type=int, metavar="RATE",
+                    help="move the link to this rate first")
+    args = ap.parse_args()
+
+    import serial  # pyserial
+
+    port = serial.Serial(args.port, args.baud, timeout=0.1)
+    time.sleep(0.1)
+    port.reset_input_buffer()
+    if args.switch and not switch_baud(port, args.switch):
+        sys.exit("baud %d: no confirmation, the device falls back to %d"
+                 % (args.switch, args.baud))
+    failed = False
+    for name, test in (("flood", flood), ("absorb", absorb)):
+        if args.only and args.only != name:
+            continue
+        result = test(port, args.bytes, args.pattern)
+        report(name, args.bytes, result, sys.stdout)
+        failed |= result[0] != args.bytes or result[1] != 0
+        time.sleep(0.1)
+        port.reset_input_buffer()
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
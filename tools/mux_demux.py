@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+"""Host side of ConsoleMux: splits a multiplexed serial port into channels.
+
+Console (channel 0) goes to stdout and lines typed on stdin are sent back
+framed on channel 0. Log (channel 2) goes to stderr. Telemetry (channel 1)
+is appended raw to --telemetry FILE, or hex-dumped to stdout if omitted.
+Frames that fail their CRC are counted and reported on exit.
+
+    python3 tools/mux_demux.py /dev/ttyUSB0 -b 115200 --telemetry tm.bin
+"""
+import argparse
+import sys
+import threading
+
+import serial  # pyserial
+
+SOF, ESC = 0x7E, 0x7D
+CH_CONSOLE, CH_TELEMETRY, CH_LOG = 0, 1, 2
+# Payload limit of frames to the device, MUX_RX_BUF_SIZE - 1
+DEVICE_MAX_PAYLOAD = 31
+
+
+def crc8(data, crc=0):
+    """CRC-8, polynomial 0x07, initial value 0; mirrors muxCrc8()."""
+    for c in data:
+        crc ^= c
+        for _ in range(8):
+            crc = (crc << 1) ^ (0x07 if crc & 0x80 else 0)
+            crc &= 0xFF
+    return crc
+
+
+def stuff(data):
+    out = bytearray()
+    for c in data:
+        if c in (SOF, ESC):
+            out += bytes((ESC, c ^ 0x20))
+        else:
+            out.append(c)
+    return out
+
+
+def frame(ch, payload, max_payload=255):
+    out = bytearray()
+    for i in range(0, len(payload), max_payload):
+        body = bytes((ch, len(payload[i:i + max_payload]))) + \
+            payload[i:i + max_payload]
+        out += bytes((SOF,)) + stuff(body + bytes((crc8(body),)))
+    return bytes(out)
+
+
+class Decoder:
+    """Byte-at-a-time frame decoder, mirrors ConsoleMux::decode()."""
+
+    def __init__(self, on_frame):
+        self.on_frame = on_frame
+        self.body = None  # Unstuffed bytes since SOF, None between frames
+        self.escaped = False
+        self.bad_frames = 0
+
+    def feed(self, data):
+        for c in data:
+            if c == SOF:
+                if self.body is not None:
+                    self.bad_frames += 1
+                self.body = bytearray()
+                self.escaped = False
+                continue
+            if self.body is None:
+                continue
+            if c == ESC:
+                self.escaped = True
+                continue
+            if self.escaped:
+                c ^= 0x20
+                self.escaped = False
+            self.body.append(c)
+            # Channel, length, payload, CRC
+            if len(self.body) > 1 and len(self.body) == self.body[1] + 3:
+                self.check(bytes(self.body))
+                self.body = None
+
+    def check(self, body):
+        if crc8(body[:-1]) != body[-1]:
+            self.bad_frames += 1
+        else:
+            self.on_frame(body[0], body[2:-1])
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("port")
+    ap.add_argument("-b", "--baud", type=int, default=115200)
+    ap.add_argument("--telemetry", metavar="FILE",
+                    help="append raw telemetry payloads to FILE")
+    args = ap.parse_args()
+
+    link = serial.Serial(args.port, args.baud, timeout=0.05)
+    telemetry = open(args.telemetry, "ab") if args.telemetry else None
+
+    def on_frame(ch, payload):
+        if ch == CH_CONSOLE:
+            sys.stdout.write(payload.decode("ascii", "replace"))
+            sys.stdout.flush()
+        elif ch == CH_LOG:
+            sys.stderr.write(payload.decode("ascii", "replace"))
+            sys.stderr.flush()
+        elif ch == CH_TELEMETRY and telemetry:
+            telemetry.write(payload)
+            telemetry.flush()
+        else:
+            print("[ch%d] %s" % (ch, payload.hex(" ")))
+
+    decoder = Decoder(on_frame)
+
+    def reader():
+        while True:
+            decoder.feed(link.read(256))
+
+    threading.Thread(target=reader, daemon=True).start()
+    try:
+        for line in sys.stdin:
+            link.write(frame(CH_CONSOLE, line.encode("ascii", "replace"),
+                             DEVICE_MAX_PAYLOAD))
+    except KeyboardInterrupt:
+        pass
+    if decoder.bad_frames:
+        print("%d bad frames" % decoder.bad_frames, file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,203 @@
+#!/usr/bin/env python3
+"""Link round trips with the console's "ping" built-in (Config::PING).
+
+Sends "ping <seq> <host_ns>" at fixed rates and splits every round trip
+with the device timestamps in the reply (micros() when the line was read
+and when the reply was written):
+
+    uplink      host sent the line -> device read it
+    processing  device read the line -> device wrote the reply
+    downlink    device wrote the reply -> host received it
+    round trip  the whole thing, host clock only
+
+Uplink and downlink need the offset between the two clocks. It is taken
+from the fastest round trip in each half of a run, assuming those were
+symmetric; interpolating between the two also takes out clock drift.
+Prints a histogram per measure and rate; --csv FILE keeps the samples.
+
+    python3 tools/ping.py /dev/ttyUSB0 -b 115200 --rates 10,100,500
+"""
+import argparse
+import json
+import sys
+import threading
+import time
+
+MEASURES = ["round trip", "uplink", "processing", "downlink"]
+
+
+class Pinger:
+    """Sends pings and collects the replies from a reader thread."""
+
+    def __init__(self, port):
+        self.port = port
+        self.replies = {}  # seq -> (recv_ns, rx_us, tx_us)
+        self.lock = threading.Lock()
+        self.running = True
+        self.thread = threading.Thread(target=self.reader, daemon=True)
+        self.thread.start()
+
+    def reader(self):
+        while self.running:
+            line = self.port.readline()
+            now = time.monotonic_ns()
+            reply = parse_reply(line)
+            if reply:
+                seq, rx, tx = reply
+                with self.lock:
+                    self.replies[seq] = (now, rx, tx)
+
+    def run(self, rate, count, first_seq):
+        """Pings count times at rate per second; returns {seq: send_ns}."""
+        sent = {}
+        start = time.monotonic_ns()
+        for i in range(count):
+            due = start + int(i * 1e9 / rate)
+            delay = (due - time.monotonic_ns()) / 1e9
+            if delay > 0:
+                time.sleep(delay)
+            seq = first_seq + i
+            now = time.monotonic_ns()
+            self.port.write(b"ping %d %d\n" % (seq, now))
+            sent[seq] = now
+        # Give the last replies time to arrive
+        deadline = time.monotonic() + 1.0
+        while time.monotonic() < deadline:
+            with self.lock:
+                if all(s in self.replies for s in sent):
+                    break
+            time.sleep(0.01)
+        return sent
+
+    def stop(self):
+        self.running = False
+
+
+def parse_reply(line):
+    """(seq, rx_us, tx_us) of a text or JSON pong, None for other lines."""
+    text = line.decode(errors="replace").strip()
+    try:
+        if text.startswith("pong "):
+            _, seq, _, rx, tx = text.split()
+            return int(seq), int(rx), int(tx)
+        if text.startswith("{"):
+            obj = json.loads(text)
+            if obj.get("cmd") == "ping" and obj.get("ok"):
+                return int(obj["seq"]), obj["rx_us"], obj["tx_us"]
+    except ValueError:
+        pass
+    return None
+
+
+def unwrap(values):
+    """micros() wraps at 2^32 on the MCU; make the sequence monotonic."""
+    out, base, prev = [], 0, None
+    for v in values:
+        if prev is not None and v + base < prev - 2**31:
+            base += 2**32
+        prev = v + base
+        out.append(prev)
+    return out
+
+
+def samples(sent, replies):
+    """Per ping: send time and the four measures, in us."""
+    seqs = sorted(s for s in sent if s in replies)
+    if not seqs:
+        return []
+    rx = unwrap([replies[s][1] for s in seqs])
+    tx = unwrap([replies[s][2] for s in seqs])
+    rows = []
+    for i, s in enumerate(seqs):
+        send = sent[s] / 1000.0
+        recv = replies[s][0] / 1000.0
+        # up = rx - send - offset, down = recv - tx + offset
+        rows.append({"seq": s, "send": send, "recv": recv, "rx": rx[i],
+                     "tx": tx[i], "a": rx[i] - send, "b": recv - tx[i]})
+
+    # Clock offset at the fastest round trip of each half, interpolated
+    half = max(1, len(rows) // 2)
+    anchors = [min(part, key=lambda r: r["a"] + r["b"])
+               for part in (rows[:half], rows[half:] or rows[:half])]
+    (t0, o0), (t1, o1) = [(r["send"], (r["a"] - r["b"]) / 2) for r in anchors]
+    slope = (o1 - o0) / (t1 - t0) if t1 != t0 else 0.0
+
+    for r in rows:
+        offset = o0 + slope * (r["send"] - t0)
+        r["round trip"] = r["recv"] - r["send"]
+        r["uplink"] = r["a"] - offset
+        r["processing"] = r["tx"] - r["rx"]
+        r["downlink"] = r["b"] + offset
+    return rows
+
+
+def percentile(values, pct):
+    values = sorted(values)
+    return values[(len(values) - 1) * pct // 100]
+
+
+def histogram(name, values, out):
+    """Summary line plus power-of-two buckets."""
+    out.write("  %-11s min %7.0f  p50 %7.0f  p90 %7.0f  p99 %7.0f  "
+              "max %7.0f us\n" % (name, min(values), percentile(values, 50),
+                                  percentile(values, 90),
+                                  percentile(values, 99), max(values)))
+    buckets = {}
+    for v in values:
+        lo = 0 if v < 1 else 1 << (int(v).bit_length() - 1)
+        buckets[lo] = buckets.get(lo, 0) + 1
+    peak = max(buckets.values())
+    for lo in sorted(buckets):
+        hi = max(lo * 2 - 1, 0)
+        bar = "#" * max(1, buckets[lo] * 40 // peak)
+        out.write("    %7d-%-7d %-40s %d\n" % (lo, hi, bar, buckets[lo]))
+
+
+def report(rate, sent, rows, out):
+    out.write("rate %g/s: %d sent, %d lost\n" % (rate, len(sent),
+                                               len(sent) - len(rows)))
+    if rows:
+        for m in MEASURES:
+            histogram(m, [r[m] for r in rows], out)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("port")
+    ap.add_argument("-b", "--baud", type=int, default=115200)
+    ap.add_argument("--rates", default="10,100",
+                    help="pings per second, comma separated")
+    ap.add_argument("--count", type=int, default=200, help="pings per rate")
+    ap.add_argument("--csv", help="write every sample to this file")
+    args = ap.parse_args()
+
+    import serial  # pyserial
+
+    port = serial.Serial(args.port, args.baud, timeout=0.1)
+    time.sleep(0.1)
+    port.reset_input_buffer()
+    pinger = Pinger(port)
+    csv = open(args.csv, "w") if args.csv else None
+    if csv:
+        csv.write("rate,seq,round_trip_us,uplink_us,processing_us,"
+                  "downlink_us\n")
+    seq = 0
+    try:
+        for rate in [float(r) for r in args.rates.split(",")]:
+            sent = pinger.run(rate, args.count, seq)
+            seq += args.count
+            rows = samples(sent, pinger.replies)
+            report(rate, sent, rows, sys.stdout)
+            for r in rows if csv else []:
+                csv.write("%g,%d,%.1f,%.1f,%.1f,%.1f\n" % (
+                    rate, r["seq"], r["round trip"], r["uplink"],
+                    r["processing"], r["downlink"]))
+    finally:
+        pinger.stop()
+        if csv:
+            csv.close()
+
+
+if __name__ == "__main__":
+    main()